@@ -1,9 +1,23 @@
 INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
-QT += core gui gui-private
+QT += core gui gui-private concurrent
 !build_xlsx_lib:DEFINES += XLSX_NO_LIB
 
+# zlib is used by ZipWriter, take the one Qt itself is built with.
+contains(QT_CONFIG, system-zlib) {
+    unix|mingw: LIBS += -lz
+    else: LIBS += zdll.lib
+} else {
+    INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+}
+
+# CONFIG += xlsx_zlib_ng to compress and inflate the package with zlib-ng.
+xlsx_zlib_ng {
+    DEFINES += XLSX_USE_ZLIB_NG
+    LIBS += -lz-ng
+}
+
 HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxdocpropsapp_p.h \
     $$PWD/xlsxrelationships_p.h \
@@ -26,6 +40,9 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxglobal.h \
     $$PWD/xlsxdrawing_p.h \
     $$PWD/xlsxzipreader_p.h \
+    $$PWD/xlsxzipcodec_p.h \
+    $$PWD/xlsxsheetdatawriter_p.h \
+    $$PWD/xlsxcelltable_p.h \
     $$PWD/xlsxdocument.h \
     $$PWD/xlsxdocument_p.h \
     $$PWD/xlsxcell.h \
@@ -33,6 +50,7 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxdatavalidation.h \
     $$PWD/xlsxdatavalidation_p.h \
     $$PWD/xlsxcellreference.h \
+    $$PWD/xlsxcellreference_p.h \
     $$PWD/xlsxcellrange.h \
     $$PWD/xlsxrichstring_p.h \
     $$PWD/xlsxrichstring.h \
@@ -66,6 +84,10 @@ SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxzipwriter.cpp \
     $$PWD/xlsxdrawing.cpp \
     $$PWD/xlsxzipreader.cpp \
+    $$PWD/xlsxzipcodec.cpp \
+    $$PWD/xlsxzipcodec_zlibng.cpp \
+    $$PWD/xlsxsheetdatawriter.cpp \
+    $$PWD/xlsxcelltable.cpp \
     $$PWD/xlsxdocument.cpp \
     $$PWD/xlsxcell.cpp \
     $$PWD/xlsxdatavalidation.cpp \
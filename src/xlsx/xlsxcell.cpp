@@ -34,14 +34,15 @@
 QT_BEGIN_NAMESPACE_XLSX
 
 CellPrivate::CellPrivate(Cell *p) :
-    q_ptr(p)
+    sharedStringIndex(-1), q_ptr(p)
 {
 
 }
 
 CellPrivate::CellPrivate(const CellPrivate * const cp)
     : value(cp->value), formula(cp->formula), cellType(cp->cellType)
-    , format(cp->format), richString(cp->richString), parent(cp->parent)
+    , format(cp->format), richString(cp->richString), sharedStringIndex(cp->sharedStringIndex)
+    , parent(cp->parent)
 {
 
 }
@@ -59,6 +59,7 @@ public:
     Format format;
 
     RichString richString;
+    int sharedStringIndex; //index in the shared strings, for SharedStringType
 
     Worksheet *parent;
     Cell *q_ptr;
@@ -24,9 +24,9 @@
 ****************************************************************************/
 #include "xlsxcellrange.h"
 #include "xlsxcellreference.h"
+#include "xlsxcellreference_p.h"
 #include <QString>
 #include <QPoint>
-#include <QStringList>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -85,20 +85,15 @@ CellRange::CellRange(const char *range)
 
 void CellRange::init(const QString &range)
 {
-    QStringList rs = range.split(QLatin1Char(':'));
-    if (rs.size() == 2) {
-        CellReference start(rs[0]);
-        CellReference end(rs[1]);
-        top = start.row();
-        left = start.column();
-        bottom = end.row();
-        right = end.column();
-    } else {
-        CellReference p(rs[0]);
-        top = p.row();
-        left = p.column();
-        bottom = p.row();
-        right = p.column();
+    const ushort *data = range.utf16();
+    const int colon = range.indexOf(QLatin1Char(':'));
+    top = left = bottom = right = -1;
+    if (colon >= 0) {
+        parseCellReference(data, colon, &top, &left);
+        parseCellReference(data + colon + 1, range.size() - colon - 1, &bottom, &right);
+    } else if (parseCellReference(data, range.size(), &top, &left)) {
+        bottom = top;
+        right = left;
     }
 }
 
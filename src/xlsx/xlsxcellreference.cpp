@@ -23,56 +23,93 @@
 **
 ****************************************************************************/
 #include "xlsxcellreference.h"
-#include <QStringList>
-#include <QMap>
-#include <QRegularExpression>
+#include "xlsxcellreference_p.h"
+#include <QGlobalStatic>
+#include <string.h>
+#include <limits.h>
 
 QT_BEGIN_NAMESPACE_XLSX
 
 namespace {
 
-int intPow(int x, int p)
+//Only used for the columns past the last one of a sheet.
+QString col_to_name(int col_num)
 {
-  if (p == 0) return 1;
-  if (p == 1) return x;
+    QString col_str;
+    int remainder;
+    while (col_num) {
+        remainder = col_num % 26;
+        if (remainder == 0)
+            remainder = 26;
+        col_str.prepend(QChar('A'+remainder-1));
+        col_num = (col_num - 1) / 26;
+    }
 
-  int tmp = intPow(x, p/2);
-  if (p%2 == 0) return tmp * tmp;
-  else return x * tmp * tmp;
+    return col_str;
 }
 
-QString col_to_name(int col_num)
+template <typename Char>
+bool parseReference(const Char *p, const Char *end, int *row, int *column)
 {
-    static QMap<int, QString> col_cache;
-
-    if (!col_cache.contains(col_num)) {
-        QString col_str;
-        int remainder;
-        while (col_num) {
-            remainder = col_num % 26;
-            if (remainder == 0)
-                remainder = 26;
-            col_str.prepend(QChar('A'+remainder-1));
-            col_num = (col_num - 1) / 26;
-        }
-        col_cache.insert(col_num, col_str);
+    if (p != end && *p == '$')
+        ++p;
+
+    const Char *letters = p;
+    int col = 0;
+    while (p != end && p - letters < 3 && *p >= 'A' && *p <= 'Z')
+        col = col * 26 + (*p++ - 'A' + 1);
+    if (p == letters)
+        return false;
+
+    if (p != end && *p == '$')
+        ++p;
+
+    const Char *digits = p;
+    qint64 r = 0;
+    for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+        r = r * 10 + (*p - '0');
+        if (r > INT_MAX)
+            return false;
     }
+    if (p == digits || p != end)
+        return false;
 
-    return col_cache[col_num];
+    *row = static_cast<int>(r);
+    *column = col;
+    return true;
 }
 
-int col_from_name(const QString &col_str)
+} //namespace
+
+ColumnNames::ColumnNames()
 {
-    int col = 0;
-    int expn = 0;
-    for (int i=col_str.size()-1; i>-1; --i) {
-        col += (col_str[i].unicode() - 'A' + 1) * intPow(26, expn);
-        expn++;
+    for (int col=1; col<=XLSX_COLUMN_MAX; ++col) {
+        char buf[4];
+        int pos = 3;
+        for (int n=col; n > 0; n = (n - 1) / 26)
+            buf[--pos] = 'A' + (n - 1) % 26;
+        lengths[col - 1] = 3 - pos;
+        memcpy(names[col - 1], buf + pos, 3 - pos);
+        names[col - 1][3 - pos] = 0;
     }
+}
+
+Q_GLOBAL_STATIC(ColumnNames, columnNames)
 
-    return col;
+const ColumnNames *ColumnNames::instance()
+{
+    return columnNames();
+}
+
+bool parseCellReference(const ushort *data, int size, int *row, int *column)
+{
+    return parseReference(data, data + size, row, column);
+}
+
+bool parseCellReference(const char *data, int size, int *row, int *column)
+{
+    return parseReference(data, data + size, row, column);
 }
-} //namespace
 
 /*!
     \class CellReference
@@ -103,8 +140,9 @@ CellReference::CellReference(int row, int column)
     Constructs the Reference form the given \a cell string.
 */
 CellReference::CellReference(const QString &cell)
+    : _row(-1), _column(-1)
 {
-    init(cell);
+    parseCellReference(cell.utf16(), cell.size(), &_row, &_column);
 }
 
 /*!
@@ -112,20 +150,9 @@ CellReference::CellReference(const QString &cell)
     Constructs the Reference form the given \a cell string.
 */
 CellReference::CellReference(const char *cell)
+    : _row(-1), _column(-1)
 {
-    init(QString::fromLatin1(cell));
-}
-
-void CellReference::init(const QString &cell_str)
-{
-    static QRegularExpression re(QStringLiteral("^\\$?([A-Z]{1,3})\\$?(\\d+)$"));
-    QRegularExpressionMatch match = re.match(cell_str);
-    if (match.hasMatch()) {
-        const QString col_str = match.captured(1);
-        const QString row_str = match.captured(2);
-        _row = row_str.toInt();
-        _column = col_from_name(col_str);
-    }
+    parseCellReference(cell, qstrlen(cell), &_row, &_column);
 }
 
 /*!
@@ -154,9 +181,15 @@ QString CellReference::toString(bool row_abs, bool col_abs) const
         return QString();
 
     QString cell_str;
+    cell_str.reserve(12);
     if (col_abs)
         cell_str.append(QLatin1Char('$'));
-    cell_str.append(col_to_name(_column));
+    if (_column <= XLSX_COLUMN_MAX) {
+        const ColumnNames *names = ColumnNames::instance();
+        cell_str.append(QLatin1String(names->names[_column - 1], names->lengths[_column - 1]));
+    } else {
+        cell_str.append(col_to_name(_column));
+    }
     if (row_abs)
         cell_str.append(QLatin1Char('$'));
     cell_str.append(QString::number(_row));
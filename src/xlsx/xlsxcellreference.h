@@ -55,7 +55,6 @@ public:
         return _row!=other._row || _column!=other._column;
     }
 private:
-    void init(const QString &cell);
     int _row, _column;
 };
 
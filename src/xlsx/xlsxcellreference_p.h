@@ -0,0 +1,73 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef QXLSX_XLSXCELLREFERENCE_P_H
+#define QXLSX_XLSXCELLREFERENCE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+const int XLSX_ROW_MAX = 1048576;
+const int XLSX_COLUMN_MAX = 16384;
+
+/*
+  The names of all the columns, "A" to "XFD", each one in a
+  nul terminated slot of four bytes. The table is built on first use.
+ */
+struct XLSX_AUTOTEST_EXPORT ColumnNames
+{
+    ColumnNames();
+
+    static const ColumnNames *instance();
+
+    char names[XLSX_COLUMN_MAX][4];
+    uchar lengths[XLSX_COLUMN_MAX];
+};
+
+/*
+  Parses a cell reference such as "A1" or "$A$1", of one to three
+  column letters, into \a row and \a column. The UTF-16 overload is
+  used for QString and QStringRef, the byte one for raw UTF-8 data.
+  Returns false, and leaves \a row and \a column alone, if \a data
+  isn't a cell reference.
+ */
+XLSX_AUTOTEST_EXPORT bool parseCellReference(const ushort *data, int size, int *row, int *column);
+XLSX_AUTOTEST_EXPORT bool parseCellReference(const char *data, int size, int *row, int *column);
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXCELLREFERENCE_P_H
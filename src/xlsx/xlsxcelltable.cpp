@@ -0,0 +1,424 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "xlsxcelltable_p.h"
+#include "xlsxcell.h"
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+int bitCount(quint16 v)
+{
+    int count = 0;
+    for (; v; v &= v - 1)
+        ++count;
+    return count;
+}
+
+int lowestBit(quint16 v)
+{
+    int bit = 0;
+    while (!(v & (1 << bit)))
+        ++bit;
+    return bit;
+}
+
+int highestBit(quint16 v)
+{
+    int bit = CellTable::BlockRows - 1;
+    while (!(v & (1 << bit)))
+        --bit;
+    return bit;
+}
+
+}
+
+Q_STATIC_ASSERT(sizeof(CellTable::CellRecord) == 16);
+
+CellTable::CellTable()
+{
+}
+
+bool CellTable::isEmpty() const
+{
+    for (int i=0; i<m_blocks.size(); ++i) {
+        if (m_blocks[i].rows)
+            return false;
+    }
+    return true;
+}
+
+/*
+  Returns the number of rows which have at least one cell.
+ */
+int CellTable::rowCount() const
+{
+    int count = 0;
+    for (int i=0; i<m_blocks.size(); ++i)
+        count += bitCount(m_blocks[i].rows);
+    return count;
+}
+
+bool CellTable::containsRow(int row) const
+{
+    const int index = (row - 1) / BlockRows;
+    if (row < 1 || index >= m_blocks.size())
+        return false;
+    return m_blocks[index].rows & (1 << ((row - 1) % BlockRows));
+}
+
+/*
+  Returns the first row after \a row which has at least one cell,
+  or -1 if there is none.
+ */
+int CellTable::nextRow(int row) const
+{
+    int index = qMax(row, 0) / BlockRows;
+    int bit = qMax(row, 0) % BlockRows;
+    for (; index < m_blocks.size(); ++index, bit = 0) {
+        const quint16 rows = m_blocks[index].rows & ~((1 << bit) - 1);
+        if (rows)
+            return index * BlockRows + lowestBit(rows) + 1;
+    }
+    return -1;
+}
+
+bool CellTable::contains(int row, int col) const
+{
+    return kind(row, col) != NoCell;
+}
+
+/*
+  Returns the smallest range which holds all the cells.
+ */
+CellRange CellTable::boundingRange() const
+{
+    int firstRow = -1;
+    int lastRow = -1;
+    int firstColumn = -1;
+    int lastColumn = -1;
+    for (int i=0; i<m_blocks.size(); ++i) {
+        const Block &block = m_blocks[i];
+        if (!block.rows)
+            continue;
+        if (firstRow == -1)
+            firstRow = i * BlockRows + lowestBit(block.rows) + 1;
+        lastRow = i * BlockRows + highestBit(block.rows) + 1;
+        //Empty columns are removed from the blocks.
+        if (firstColumn == -1 || block.columns.first().column < firstColumn)
+            firstColumn = block.columns.first().column;
+        if (block.columns.last().column > lastColumn)
+            lastColumn = block.columns.last().column;
+    }
+    return CellRange(firstRow, firstColumn, lastRow, lastColumn);
+}
+
+/*
+  Returns the record of the cell at (\a row, \a col), or 0 if there
+  is no such cell.
+ */
+const CellTable::CellRecord *CellTable::record(int row, int col) const
+{
+    const Column *column = findColumn(row, col);
+    return column ? &column->at((row - 1) % BlockRows) : 0;
+}
+
+CellTable::CellKind CellTable::kind(int row, int col) const
+{
+    const CellRecord *rec = record(row, col);
+    return rec ? static_cast<CellKind>(rec->kind) : NoCell;
+}
+
+double CellTable::number(int row, int col) const
+{
+    const CellRecord *rec = record(row, col);
+    if (!rec || rec->kind == StringCell)
+        return 0.0;
+    return rec->number;
+}
+
+int CellTable::stringIndex(int row, int col) const
+{
+    const CellRecord *rec = record(row, col);
+    return rec && rec->kind == StringCell ? rec->index : -1;
+}
+
+int CellTable::style(int row, int col) const
+{
+    const CellRecord *rec = record(row, col);
+    return rec ? rec->style : -1;
+}
+
+CellFormula CellTable::formula(int row, int col) const
+{
+    return m_formulas.value(cellKey(row, col));
+}
+
+RichString CellTable::inlineString(int row, int col) const
+{
+    return m_inlineStrings.value(cellKey(row, col));
+}
+
+QSharedPointer<Cell> CellTable::cell(int row, int col) const
+{
+    return m_cells.value(cellKey(row, col));
+}
+
+void CellTable::setNumber(int row, int col, double value, int style)
+{
+    set(row, col, NumberCell, style).number = value;
+}
+
+void CellTable::setBoolean(int row, int col, bool value, int style)
+{
+    set(row, col, BooleanCell, style).number = value ? 1 : 0;
+}
+
+void CellTable::setString(int row, int col, int sstIndex, int style)
+{
+    set(row, col, StringCell, style).index = sstIndex;
+}
+
+void CellTable::setBlank(int row, int col, int style)
+{
+    set(row, col, BlankCell, style).number = 0;
+}
+
+void CellTable::setFormula(int row, int col, const CellFormula &formula, double result, int style)
+{
+    set(row, col, FormulaCell, style).number = result;
+    m_formulas.insert(cellKey(row, col), formula);
+}
+
+void CellTable::setInlineString(int row, int col, const RichString &text, int style)
+{
+    set(row, col, InlineStringCell, style).number = 0;
+    m_inlineStrings.insert(cellKey(row, col), text);
+}
+
+void CellTable::setCell(int row, int col, const QSharedPointer<Cell> &cell)
+{
+    set(row, col, ObjectCell, -1).number = 0;
+    m_cells.insert(cellKey(row, col), cell);
+}
+
+void CellTable::remove(int row, int col)
+{
+    const int index = (row - 1) / BlockRows;
+    if (row < 1 || index >= m_blocks.size())
+        return;
+
+    Block &block = m_blocks[index];
+    const quint16 bit = 1 << ((row - 1) % BlockRows);
+    for (int i=0; i<block.columns.size(); ++i) {
+        Column &column = block.columns[i];
+        if (column.column != col)
+            continue;
+        if (!(column.rows & bit))
+            return;
+        const int k = column.index((row - 1) % BlockRows);
+        release(row, col, column.cells[k].kind);
+        column.cells.remove(k);
+        column.rows &= ~bit;
+        if (!column.rows)
+            block.columns.remove(i);
+
+        block.rows = 0;
+        for (int j=0; j<block.columns.size(); ++j)
+            block.rows |= block.columns[j].rows;
+        return;
+    }
+}
+
+/*
+  Replace the shared string index of each string cell by its entry
+  in \a indexMap.
+ */
+void CellTable::remapStrings(const QVector<int> &indexMap)
+{
+    for (int i=0; i<m_blocks.size(); ++i) {
+        Block &block = m_blocks[i];
+        for (int j=0; j<block.columns.size(); ++j) {
+            Column &column = block.columns[j];
+            for (int k=0; k<column.cells.size(); ++k) {
+                CellRecord &record = column.cells[k];
+                if (record.kind == StringCell)
+                    record.index = indexMap.value(record.index, -1);
+            }
+        }
+    }
+}
+
+/*
+  Remove all the rows up to \a lastRow.
+ */
+void CellTable::removeRows(int lastRow)
+{
+    const int lastBlock = qMin(lastRow / BlockRows, m_blocks.size());
+    for (int i=0; i<lastBlock; ++i) {
+        const Block &block = m_blocks[i];
+        for (int j=0; j<block.columns.size(); ++j) {
+            const Column &column = block.columns[j];
+            for (int r=0, k=0; r<BlockRows; ++r) {
+                if (column.rows & (1 << r))
+                    release(i * BlockRows + r + 1, column.column, column.cells[k++].kind);
+            }
+        }
+        m_blocks[i] = Block();
+    }
+
+    //The rows of the block which is only partly removed.
+    if (lastRow % BlockRows && lastBlock < m_blocks.size()) {
+        QList<quint64> keys;
+        const Block &block = m_blocks[lastBlock];
+        for (int j=0; j<block.columns.size(); ++j) {
+            for (int r=0; r<lastRow % BlockRows; ++r) {
+                if (block.columns[j].rows & (1 << r))
+                    keys.append(cellKey(lastBlock * BlockRows + r + 1, block.columns[j].column));
+            }
+        }
+        foreach (quint64 key, keys)
+            remove(keyRow(key), keyColumn(key));
+    }
+}
+
+int CellTable::blockCount() const
+{
+    return m_blocks.size();
+}
+
+const CellTable::Block *CellTable::block(int index) const
+{
+    return &m_blocks.at(index);
+}
+
+/*
+  Returns the cells which are stored as Cell objects.
+ */
+const QHash<quint64, QSharedPointer<Cell> > &CellTable::cells() const
+{
+    return m_cells;
+}
+
+const CellTable::Column *CellTable::findColumn(int row, int col) const
+{
+    const int index = (row - 1) / BlockRows;
+    if (row < 1 || index >= m_blocks.size())
+        return 0;
+
+    const Block &block = m_blocks.at(index);
+    if (!(block.rows & (1 << ((row - 1) % BlockRows))))
+        return 0;
+
+    //Binary search, the columns are sorted.
+    int first = 0;
+    int last = block.columns.size() - 1;
+    while (first <= last) {
+        const int middle = (first + last) / 2;
+        const Column &column = block.columns.at(middle);
+        if (column.column < col) {
+            first = middle + 1;
+        } else if (column.column > col) {
+            last = middle - 1;
+        } else {
+            if (!(column.rows & (1 << ((row - 1) % BlockRows))))
+                return 0;
+            return &column;
+        }
+    }
+    return 0;
+}
+
+CellTable::Column &CellTable::insertColumn(int row, int col)
+{
+    const int index = (row - 1) / BlockRows;
+    if (index >= m_blocks.size())
+        m_blocks.resize(index + 1);
+
+    QVector<Column> &columns = m_blocks[index].columns;
+
+    //Cells are mostly written column after column, so check the last one first.
+    int pos = columns.size();
+    if (!columns.isEmpty() && columns.last().column >= col) {
+        int first = 0;
+        int last = columns.size() - 1;
+        while (first <= last) {
+            const int middle = (first + last) / 2;
+            if (columns.at(middle).column < col)
+                first = middle + 1;
+            else if (columns.at(middle).column > col)
+                last = middle - 1;
+            else
+                return columns[middle];
+        }
+        pos = first;
+    }
+
+    Column column;
+    column.column = col;
+    columns.insert(pos, column);
+    return columns[pos];
+}
+
+/*
+  Returns the record of the cell, of which only the value is left
+  to be set. The side data of the previous cell is dropped.
+ */
+CellTable::CellRecord &CellTable::set(int row, int col, CellKind kind, int style)
+{
+    Q_ASSERT(row >= 1 && col >= 1);
+    Column &column = insertColumn(row, col);
+    const int r = (row - 1) % BlockRows;
+    const int index = column.index(r);
+    if (column.rows & (1 << r)) {
+        release(row, col, column.cells[index].kind);
+    } else {
+        //A column grows one record at a time while it is sparse, once it
+        //has more than SparseRows cells it is likely to fill the block.
+        if (column.cells.size() == column.cells.capacity())
+            column.cells.reserve(column.cells.size() < SparseRows ? column.cells.size() + 1 : int(BlockRows));
+        column.cells.insert(index, CellRecord());
+        column.rows |= 1 << r;
+        m_blocks[(row - 1) / BlockRows].rows |= 1 << r;
+    }
+
+    CellRecord &rec = column.cells[index];
+    rec.kind = kind;
+    rec.style = style;
+    return rec;
+}
+
+void CellTable::release(int row, int col, quint8 kind)
+{
+    if (kind == FormulaCell)
+        m_formulas.remove(cellKey(row, col));
+    else if (kind == InlineStringCell)
+        m_inlineStrings.remove(cellKey(row, col));
+    else if (kind == ObjectCell)
+        m_cells.remove(cellKey(row, col));
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,175 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef QXLSX_XLSXCELLTABLE_P_H
+#define QXLSX_XLSXCELLTABLE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include "xlsxcellrange.h"
+#include "xlsxcellformula.h"
+#include "xlsxrichstring.h"
+
+#include <QVector>
+#include <QHash>
+#include <QSharedPointer>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class Cell;
+
+/*
+  The cells of a worksheet.
+
+  Rows are grouped in blocks of BlockRows rows. Within a block, each
+  column in use has a 16 bytes record per cell: the kind of the cell,
+  its style (xf) index and its value, which is either a number or a
+  shared string index. The records of a column are packed, so a
+  column with a single cell in the block doesn't take the room of a
+  full one.
+
+  Formulas and inline strings are kept in side tables keyed by the
+  position of the cell. Cells which have been handed out as Cell
+  objects, and the few which can't be described by a record, are
+  kept in a sparse hash instead.
+ */
+class XLSX_AUTOTEST_EXPORT CellTable
+{
+public:
+    enum { BlockRows = 16, SparseRows = 4 };
+
+    enum CellKind {
+        NoCell,
+        NumberCell,
+        BooleanCell,
+        StringCell,         //shared string
+        BlankCell,
+        FormulaCell,        //formula with a numeric result
+        InlineStringCell,
+        ObjectCell          //stored as a Cell
+    };
+
+    struct CellRecord
+    {
+        union {
+            double number;  //number, boolean or formula result
+            qint32 index;   //shared string index
+        };
+        qint32 style;
+        quint8 kind;
+    };
+
+    struct Column
+    {
+        Column() : column(0), rows(0) {}
+
+        //Returns the position in cells of the record of row r of the block.
+        int index(int r) const
+        {
+            int count = 0;
+            for (quint16 v = rows & ((1 << r) - 1); v; v &= v - 1)
+                ++count;
+            return count;
+        }
+        const CellRecord &at(int r) const { return cells.at(index(r)); }
+
+        int column;
+        quint16 rows;   //bit i is set if row i of the block has a cell
+        QVector<CellRecord> cells; //one per cell, in the order of the rows
+    };
+
+    struct Block
+    {
+        Block() : rows(0) {}
+        quint16 rows;
+        QVector<Column> columns; //sorted by column
+    };
+
+    CellTable();
+
+    bool isEmpty() const;
+    int rowCount() const;
+    bool containsRow(int row) const;
+    int nextRow(int row) const;
+    bool contains(int row, int col) const;
+    CellRange boundingRange() const;
+
+    const CellRecord *record(int row, int col) const;
+    CellKind kind(int row, int col) const;
+    double number(int row, int col) const;
+    int stringIndex(int row, int col) const;
+    int style(int row, int col) const;
+    CellFormula formula(int row, int col) const;
+    RichString inlineString(int row, int col) const;
+    QSharedPointer<Cell> cell(int row, int col) const;
+
+    void setNumber(int row, int col, double value, int style);
+    void setBoolean(int row, int col, bool value, int style);
+    void setString(int row, int col, int sstIndex, int style);
+    void setBlank(int row, int col, int style);
+    void setFormula(int row, int col, const CellFormula &formula, double result, int style);
+    void setInlineString(int row, int col, const RichString &text, int style);
+    void setCell(int row, int col, const QSharedPointer<Cell> &cell);
+    void remove(int row, int col);
+    void removeRows(int lastRow);
+    void remapStrings(const QVector<int> &indexMap);
+
+    int blockCount() const;
+    const Block *block(int index) const;
+    const QHash<quint64, QSharedPointer<Cell> > &cells() const;
+
+    static quint64 cellKey(int row, int col) { return (quint64(row) << 32) | quint32(col); }
+    static int keyRow(quint64 key) { return int(key >> 32); }
+    static int keyColumn(quint64 key) { return int(key & 0xffffffff); }
+
+private:
+    const Column *findColumn(int row, int col) const;
+    Column &insertColumn(int row, int col);
+    CellRecord &set(int row, int col, CellKind kind, int style);
+    void release(int row, int col, quint8 kind);
+
+    QVector<Block> m_blocks; //indexed by (row - 1) / BlockRows
+    QHash<quint64, CellFormula> m_formulas;
+    QHash<quint64, RichString> m_inlineStrings;
+    QHash<quint64, QSharedPointer<Cell> > m_cells;
+};
+
+QT_END_NAMESPACE_XLSX
+
+Q_DECLARE_TYPEINFO(QXlsx::CellTable::CellRecord, Q_PRIMITIVE_TYPE);
+Q_DECLARE_TYPEINFO(QXlsx::CellTable::Column, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(QXlsx::CellTable::Block, Q_MOVABLE_TYPE);
+
+#endif // QXLSX_XLSXCELLTABLE_P_H
@@ -390,40 +390,25 @@ void DataValidation::addRange(const CellRange &range)
  */
 bool DataValidation::saveToXml(QXmlStreamWriter &writer) const
 {
-    static QMap<DataValidation::ValidationType, QString> typeMap;
-    static QMap<DataValidation::ValidationOperator, QString> opMap;
-    static QMap<DataValidation::ErrorStyle, QString> esMap;
-    if (typeMap.isEmpty()) {
-        typeMap.insert(DataValidation::None, QStringLiteral("none"));
-        typeMap.insert(DataValidation::Whole, QStringLiteral("whole"));
-        typeMap.insert(DataValidation::Decimal, QStringLiteral("decimal"));
-        typeMap.insert(DataValidation::List, QStringLiteral("list"));
-        typeMap.insert(DataValidation::Date, QStringLiteral("date"));
-        typeMap.insert(DataValidation::Time, QStringLiteral("time"));
-        typeMap.insert(DataValidation::TextLength, QStringLiteral("textLength"));
-        typeMap.insert(DataValidation::Custom, QStringLiteral("custom"));
-
-        opMap.insert(DataValidation::Between, QStringLiteral("between"));
-        opMap.insert(DataValidation::NotBetween, QStringLiteral("notBetween"));
-        opMap.insert(DataValidation::Equal, QStringLiteral("equal"));
-        opMap.insert(DataValidation::NotEqual, QStringLiteral("notEqual"));
-        opMap.insert(DataValidation::LessThan, QStringLiteral("lessThan"));
-        opMap.insert(DataValidation::LessThanOrEqual, QStringLiteral("lessThanOrEqual"));
-        opMap.insert(DataValidation::GreaterThan, QStringLiteral("greaterThan"));
-        opMap.insert(DataValidation::GreaterThanOrEqual, QStringLiteral("greaterThanOrEqual"));
-
-        esMap.insert(DataValidation::Stop, QStringLiteral("stop"));
-        esMap.insert(DataValidation::Warning, QStringLiteral("warning"));
-        esMap.insert(DataValidation::Information, QStringLiteral("information"));
-    }
+    //Constant tables, so that worksheets can be saved concurrently.
+    static const char * const typeNames[] = {
+        "none", "whole", "decimal", "list", "date", "time", "textLength", "custom"
+    };
+    static const char * const opNames[] = {
+        "between", "notBetween", "equal", "notEqual",
+        "lessThan", "lessThanOrEqual", "greaterThan", "greaterThanOrEqual"
+    };
+    static const char * const esNames[] = {
+        "stop", "warning", "information"
+    };
 
     writer.writeStartElement(QStringLiteral("dataValidation"));
     if (validationType() != DataValidation::None)
-        writer.writeAttribute(QStringLiteral("type"), typeMap[validationType()]);
+        writer.writeAttribute(QStringLiteral("type"), QLatin1String(typeNames[validationType()]));
     if (errorStyle() != DataValidation::Stop)
-        writer.writeAttribute(QStringLiteral("errorStyle"), esMap[errorStyle()]);
+        writer.writeAttribute(QStringLiteral("errorStyle"), QLatin1String(esNames[errorStyle()]));
     if (validationOperator() != DataValidation::Between)
-        writer.writeAttribute(QStringLiteral("operator"), opMap[validationOperator()]);
+        writer.writeAttribute(QStringLiteral("operator"), QLatin1String(opNames[validationOperator()]));
     if (allowBlank())
         writer.writeAttribute(QStringLiteral("allowBlank"), QStringLiteral("1"));
     //        if (dropDownVisible())
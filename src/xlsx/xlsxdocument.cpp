@@ -27,6 +27,7 @@
 #include "xlsxdocument_p.h"
 #include "xlsxworkbook.h"
 #include "xlsxworksheet.h"
+#include "xlsxworksheet_p.h"
 #include "xlsxcontenttypes_p.h"
 #include "xlsxrelationships_p.h"
 #include "xlsxstyles_p.h"
@@ -46,6 +47,8 @@
 #include <QPointF>
 #include <QBuffer>
 #include <QDir>
+#include <QFuture>
+#include <QtConcurrentRun>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -85,7 +88,8 @@ QT_BEGIN_NAMESPACE_XLSX
 */
 
 DocumentPrivate::DocumentPrivate(Document *p) :
-    q_ptr(p), defaultPackageName(QStringLiteral("Book1.xlsx"))
+    q_ptr(p), defaultPackageName(QStringLiteral("Book1.xlsx")), parallelSave(false),
+    compressionLevel(-1)
 {
 }
 
@@ -231,20 +235,147 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
     return true;
 }
 
+/*
+  Serialize the \a part straight into the zip entry \a filePath, so
+  that its xml data never has to be held in memory as a whole.
+ */
+static void savePart(ZipWriter &zipWriter, const QString &filePath, const AbstractOOXmlFile *part)
+{
+    part->saveToXmlFile(zipWriter.beginFile(filePath));
+    zipWriter.endFile();
+}
+
+static void savePart(ZipWriter &zipWriter, const QString &filePath, const Relationships *rels)
+{
+    rels->saveToXmlFile(zipWriter.beginFile(filePath));
+    zipWriter.endFile();
+}
+
+static void savePart(ZipWriter &zipWriter, const QString &filePath, const QByteArray &data)
+{
+    zipWriter.writeFile(filePath, data);
+}
+
+namespace {
+
+struct PartData
+{
+    QByteArray data;
+    QByteArray relsData;
+};
+
+PartData serializePart(const AbstractOOXmlFile *part)
+{
+    PartData result;
+    result.data = part->saveToXmlData();
+    if (!part->relationships()->isEmpty())
+        result.relsData = part->relationships()->saveToXmlData();
+    return result;
+}
+
+/*
+  Writes the parts of a package into the zip in the order they are
+  saved. The parts given to the constructor are serialized into memory
+  by the global thread pool in the meantime, every other part is
+  streamed into the zip directly. Each part has its own future, which
+  is dropped as soon as the part has been written, so the serialized
+  data of a part isn't kept until the whole package is saved. As each
+  worker produces exactly the bytes the sequential path would have
+  streamed, the package doesn't depend on whether the parallel save is
+  used or not.
+ */
+class PackageWriter
+{
+public:
+    PackageWriter(ZipWriter &zipWriter, const QList<const AbstractOOXmlFile *> &parallelParts)
+        : m_zipWriter(zipWriter), m_parallelParts(parallelParts), m_next(0)
+    {
+        m_results.reserve(m_parallelParts.size());
+        for (int i=0; i<m_parallelParts.size(); ++i)
+            m_results.append(QtConcurrent::run(serializePart, m_parallelParts[i]));
+    }
+
+    ~PackageWriter()
+    {
+        for (int i=m_next; i<m_results.size(); ++i)
+            m_results[i].waitForFinished();
+    }
+
+    void savePart(const QString &filePath, const AbstractOOXmlFile *part, const QString &relsFilePath=QString())
+    {
+        if (m_next < m_parallelParts.size() && m_parallelParts[m_next] == part) {
+            const PartData result = m_results[m_next].result();
+            //Release the result held by the future.
+            m_results[m_next++] = QFuture<PartData>();
+            QXlsx::savePart(m_zipWriter, filePath, result.data);
+            if (!relsFilePath.isEmpty() && !result.relsData.isEmpty())
+                QXlsx::savePart(m_zipWriter, relsFilePath, result.relsData);
+            return;
+        }
+
+        QXlsx::savePart(m_zipWriter, filePath, part);
+        if (!relsFilePath.isEmpty() && !part->relationships()->isEmpty())
+            QXlsx::savePart(m_zipWriter, relsFilePath, part->relationships());
+    }
+
+    void savePart(const QString &filePath, const Relationships *rels)
+    {
+        QXlsx::savePart(m_zipWriter, filePath, rels);
+    }
+
+private:
+    ZipWriter &m_zipWriter;
+    QList<const AbstractOOXmlFile *> m_parallelParts;
+    QVector<QFuture<PartData> > m_results;
+    int m_next;
+};
+
+} // namespace
+
 bool DocumentPrivate::savePackage(QIODevice *device) const
 {
     Q_Q(const Document);
     ZipWriter zipWriter(device);
     if (zipWriter.error())
         return false;
+    zipWriter.setParallelCompressionEnabled(parallelSave);
+    zipWriter.setCompressionLevel(compressionLevel);
+    for (int i=0; i<partCompressionLevels.size(); ++i)
+        zipWriter.setCompressionLevel(partCompressionLevels[i].first, partCompressionLevels[i].second);
 
     contentTypes->clearOverrides();
 
+    //Unused shared strings are dropped before any part is saved.
+    workbook->compactSharedStrings();
+
     DocPropsApp docPropsApp(DocPropsApp::F_NewFromScratch);
     DocPropsCore docPropsCore(DocPropsCore::F_NewFromScratch);
 
-    // save worksheet xml files
     QList<QSharedPointer<AbstractSheet> > worksheets = workbook->getSheetsByTypes(AbstractSheet::ST_WorkSheet);
+    QList<QSharedPointer<AbstractSheet> > chartsheets = workbook->getSheetsByTypes(AbstractSheet::ST_ChartSheet);
+
+    // the parts which don't depend on each other can be serialized
+    // concurrently, they must be listed in the order they are saved.
+    // A sheet which has streamed rows into its temporary file is left
+    // out, it is streamed through the zip writer as in a sequential save.
+    QList<const AbstractOOXmlFile *> parallelParts;
+    if (parallelSave) {
+        foreach (QSharedPointer<AbstractSheet> sheet, worksheets) {
+            if (!static_cast<Worksheet *>(sheet.data())->d_func()->streamFile)
+                parallelParts.append(sheet.data());
+        }
+        foreach (QSharedPointer<AbstractSheet> sheet, chartsheets)
+            parallelParts.append(sheet.data());
+        foreach (Drawing *drawing, workbook->drawings())
+            parallelParts.append(drawing);
+        if (!workbook->sharedStrings()->isEmpty())
+            parallelParts.append(workbook->sharedStrings());
+        foreach (QSharedPointer<Chart> cf, workbook->chartFiles())
+            parallelParts.append(cf.data());
+    }
+    PackageWriter writer(zipWriter, parallelParts);
+
+    // save worksheet xml files
     if (!worksheets.isEmpty())
         docPropsApp.addHeadingPair(QStringLiteral("Worksheets"), worksheets.size());
     for (int i=0; i<worksheets.size(); ++i) {
@@ -252,14 +383,11 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         contentTypes->addWorksheetName(QStringLiteral("sheet%1").arg(i+1));
         docPropsApp.addPartTitle(sheet->sheetName());
 
-        zipWriter.addFile(QStringLiteral("xl/worksheets/sheet%1.xml").arg(i+1), sheet->saveToXmlData());
-        Relationships *rel = sheet->relationships();
-        if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/worksheets/_rels/sheet%1.xml.rels").arg(i+1), rel->saveToXmlData());
+        writer.savePart(QStringLiteral("xl/worksheets/sheet%1.xml").arg(i+1), sheet.data(),
+                        QStringLiteral("xl/worksheets/_rels/sheet%1.xml.rels").arg(i+1));
     }
 
     //save chartsheet xml files
-    QList<QSharedPointer<AbstractSheet> > chartsheets = workbook->getSheetsByTypes(AbstractSheet::ST_ChartSheet);
     if (!chartsheets.isEmpty())
         docPropsApp.addHeadingPair(QStringLiteral("Chartsheets"), chartsheets.size());
     for (int i=0; i<chartsheets.size(); ++i) {
@@ -267,10 +395,8 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         contentTypes->addWorksheetName(QStringLiteral("sheet%1").arg(i+1));
         docPropsApp.addPartTitle(sheet->sheetName());
 
-        zipWriter.addFile(QStringLiteral("xl/chartsheets/sheet%1.xml").arg(i+1), sheet->saveToXmlData());
-        Relationships *rel = sheet->relationships();
-        if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/chartsheets/_rels/sheet%1.xml.rels").arg(i+1), rel->saveToXmlData());
+        writer.savePart(QStringLiteral("xl/chartsheets/sheet%1.xml").arg(i+1), sheet.data(),
+                        QStringLiteral("xl/chartsheets/_rels/sheet%1.xml.rels").arg(i+1));
     }
 
     // save external links xml files
@@ -278,25 +404,22 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         SimpleOOXmlFile *link = workbook->d_func()->externalLinks[i].data();
         contentTypes->addExternalLinkName(QStringLiteral("externalLink%1").arg(i+1));
 
-        zipWriter.addFile(QStringLiteral("xl/externalLinks/externalLink%1.xml").arg(i+1), link->saveToXmlData());
-        Relationships *rel = link->relationships();
-        if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/externalLinks/_rels/externalLink%1.xml.rels").arg(i+1), rel->saveToXmlData());
+        writer.savePart(QStringLiteral("xl/externalLinks/externalLink%1.xml").arg(i+1), link,
+                        QStringLiteral("xl/externalLinks/_rels/externalLink%1.xml.rels").arg(i+1));
     }
 
     // save workbook xml file
     contentTypes->addWorkbook();
-    zipWriter.addFile(QStringLiteral("xl/workbook.xml"), workbook->saveToXmlData());
-    zipWriter.addFile(QStringLiteral("xl/_rels/workbook.xml.rels"), workbook->relationships()->saveToXmlData());
+    writer.savePart(QStringLiteral("xl/workbook.xml"), workbook.data());
+    writer.savePart(QStringLiteral("xl/_rels/workbook.xml.rels"), workbook->relationships());
 
     // save drawing xml files
     for (int i=0; i<workbook->drawings().size(); ++i) {
         contentTypes->addDrawingName(QStringLiteral("drawing%1").arg(i+1));
 
         Drawing *drawing = workbook->drawings()[i];
-        zipWriter.addFile(QStringLiteral("xl/drawings/drawing%1.xml").arg(i+1), drawing->saveToXmlData());
-        if (!drawing->relationships()->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/drawings/_rels/drawing%1.xml.rels").arg(i+1), drawing->relationships()->saveToXmlData());
+        writer.savePart(QStringLiteral("xl/drawings/drawing%1.xml").arg(i+1), drawing,
+                        QStringLiteral("xl/drawings/_rels/drawing%1.xml.rels").arg(i+1));
     }
 
     // save docProps app/core xml file
@@ -306,28 +429,28 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
     }
     contentTypes->addDocPropApp();
     contentTypes->addDocPropCore();
-    zipWriter.addFile(QStringLiteral("docProps/app.xml"), docPropsApp.saveToXmlData());
-    zipWriter.addFile(QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData());
+    writer.savePart(QStringLiteral("docProps/app.xml"), &docPropsApp);
+    writer.savePart(QStringLiteral("docProps/core.xml"), &docPropsCore);
 
     // save sharedStrings xml file
     if (!workbook->sharedStrings()->isEmpty()) {
         contentTypes->addSharedString();
-        zipWriter.addFile(QStringLiteral("xl/sharedStrings.xml"), workbook->sharedStrings()->saveToXmlData());
+        writer.savePart(QStringLiteral("xl/sharedStrings.xml"), workbook->sharedStrings());
     }
 
     // save styles xml file
     contentTypes->addStyles();
-    zipWriter.addFile(QStringLiteral("xl/styles.xml"), workbook->styles()->saveToXmlData());
+    writer.savePart(QStringLiteral("xl/styles.xml"), workbook->styles());
 
     // save theme xml file
     contentTypes->addTheme();
-    zipWriter.addFile(QStringLiteral("xl/theme/theme1.xml"), workbook->theme()->saveToXmlData());
+    writer.savePart(QStringLiteral("xl/theme/theme1.xml"), workbook->theme());
 
     // save chart xml files
     for (int i=0; i<workbook->chartFiles().size(); ++i) {
         contentTypes->addChartName(QStringLiteral("chart%1").arg(i+1));
         QSharedPointer<Chart> cf = workbook->chartFiles()[i];
-        zipWriter.addFile(QStringLiteral("xl/charts/chart%1.xml").arg(i+1), cf->saveToXmlData());
+        writer.savePart(QStringLiteral("xl/charts/chart%1.xml").arg(i+1), cf.data());
     }
 
     // save image files
@@ -344,13 +467,13 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
     rootrels.addDocumentRelationship(QStringLiteral("/officeDocument"), QStringLiteral("xl/workbook.xml"));
     rootrels.addPackageRelationship(QStringLiteral("/metadata/core-properties"), QStringLiteral("docProps/core.xml"));
     rootrels.addDocumentRelationship(QStringLiteral("/extended-properties"), QStringLiteral("docProps/app.xml"));
-    zipWriter.addFile(QStringLiteral("_rels/.rels"), rootrels.saveToXmlData());
+    writer.savePart(QStringLiteral("_rels/.rels"), &rootrels);
 
     // save content types xml file
-    zipWriter.addFile(QStringLiteral("[Content_Types].xml"), contentTypes->saveToXmlData());
+    writer.savePart(QStringLiteral("[Content_Types].xml"), contentTypes.data());
 
     zipWriter.close();
-    return true;
+    return !zipWriter.error();
 }
 
 
@@ -424,6 +547,34 @@ bool Document::write(int row, int col, const QVariant &value, const Format &form
     return false;
 }
 
+/*!
+ * Write the \a values to the row \a row of the current worksheet,
+ * from the column \a firstCol on, with the \a format.
+ * Returns true on success.
+ *
+ * \sa Worksheet::writeRow()
+ */
+bool Document::writeRow(int row, int firstCol, const QVector<QVariant> &values, const Format &format)
+{
+    if (Worksheet *sheet = currentWorksheet())
+        return sheet->writeRow(row, firstCol, values, format);
+    return false;
+}
+
+/*!
+ * Write the rows of \a values to the current worksheet, from the cell
+ * \a topLeft on, with the \a format.
+ * Returns true on success.
+ *
+ * \sa Worksheet::writeRange()
+ */
+bool Document::writeRange(const CellReference &topLeft, const QVector<QVector<QVariant> > &values, const Format &format)
+{
+    if (Worksheet *sheet = currentWorksheet())
+        return sheet->writeRange(topLeft, values, format);
+    return false;
+}
+
 /*!
     \overload
     Returns the contents of the cell \a cell.
@@ -815,6 +966,35 @@ bool Document::defineName(const QString &name, const QString &formula, const QSt
     return d->workbook->defineName(name, formula, comment, scope);
 }
 
+/*!
+ * Registers the \a format with the workbook and returns a handle to it,
+ * which can be passed to the write functions of the worksheets. This is
+ * cheaper than passing the format for each cell.
+ *
+ * \sa Workbook::internStyle()
+ */
+StyleId Document::internStyle(const Format &format)
+{
+    Q_D(Document);
+
+    return d->workbook->internStyle(format);
+}
+
+/*!
+ * Registers the plain text \a string with the workbook and returns a
+ * handle to it, which can be passed to Worksheet::writeString(). This
+ * is cheaper than passing the string for each cell when a column only
+ * holds a few distinct values.
+ *
+ * \sa Workbook::internString()
+ */
+StringId Document::internString(const QString &string)
+{
+    Q_D(Document);
+
+    return d->workbook->internString(string);
+}
+
 /*!
     Return the range that contains cell data.
  */
@@ -998,6 +1178,89 @@ QStringList Document::sheetNames() const
     return d->workbook->worksheetNames();
 }
 
+/*!
+ * Returns whether the independent parts of the document, such as the
+ * worksheets, are serialized concurrently when the document is saved.
+ * The default is false.
+ */
+bool Document::isParallelSaveEnabled() const
+{
+    Q_D(const Document);
+    return d->parallelSave;
+}
+
+/*!
+ * Enables or disables the concurrent serialization of the independent
+ * parts of the document when it is saved, depending on \a enable.
+ *
+ * The parts are serialized and compressed by the threads of
+ * QThreadPool::globalInstance() and written into the package in the same
+ * order as otherwise, so the saved file is identical either way. A part
+ * serialized ahead of its turn is held in memory until it has been
+ * written, which makes the save faster for documents with several large
+ * worksheets at the cost of a higher peak memory usage. Worksheets whose
+ * rows have been streamed into a temporary file, see
+ * Worksheet::setStreamingWindow(), aren't serialized ahead: they are
+ * compressed into the package while being written, without being held
+ * in memory, the same as without parallel save.
+ *
+ * The document must not be modified by other threads while it is saved.
+ */
+void Document::setParallelSaveEnabled(bool enable)
+{
+    Q_D(Document);
+    d->parallelSave = enable;
+}
+
+/*!
+ * Returns the compression level used for the parts of the document
+ * when it is saved. The default is -1.
+ *
+ * \sa setCompressionLevel()
+ */
+int Document::compressionLevel() const
+{
+    Q_D(const Document);
+    return d->compressionLevel;
+}
+
+/*!
+ * Sets the compression \a level used for the parts of the document when
+ * it is saved, from 1 (fastest) to 9 (smallest). Level 0 stores the parts
+ * without compression, and -1 selects the default level of zlib, which
+ * is a good compromise between speed and size.
+ */
+void Document::setCompressionLevel(int level)
+{
+    Q_D(Document);
+    d->compressionLevel = qBound(-1, level, 9);
+}
+
+/*!
+ * \overload
+ * Sets the compression \a level of the parts whose name in the package
+ * matches the wildcard \a partPattern, overriding the level set for the
+ * document. For example, images which are already compressed can be
+ * stored as they are with:
+ *
+ * \code
+ * xlsx.setCompressionLevel("xl/media/*", 0);
+ * \endcode
+ *
+ * When several patterns match a part, the one set last is used.
+ */
+void Document::setCompressionLevel(const QString &partPattern, int level)
+{
+    Q_D(Document);
+    for (int i=0; i<d->partCompressionLevels.size(); ++i) {
+        if (d->partCompressionLevels[i].first == partPattern) {
+            d->partCompressionLevels.removeAt(i);
+            break;
+        }
+    }
+    d->partCompressionLevels.append(qMakePair(partPattern, qBound(-1, level, 9)));
+}
+
 /*!
  * Save current document to the filesystem. If no name specified when
  * the document constructed, a default name "book1.xlsx" will be used.
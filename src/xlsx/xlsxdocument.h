@@ -58,6 +58,8 @@ public:
 
     bool write(const CellReference &cell, const QVariant &value, const Format &format=Format());
     bool write(int row, int col, const QVariant &value, const Format &format=Format());
+    bool writeRow(int row, int firstCol, const QVector<QVariant> &values, const Format &format=Format());
+    bool writeRange(const CellReference &topLeft, const QVector<QVector<QVariant> > &values, const Format &format=Format());
     QVariant read(const CellReference &cell) const;
     QVariant read(int row, int col) const;
     bool insertImage(int row, int col, const QImage &image);
@@ -98,6 +100,8 @@ public:
     Cell *cellAt(int row, int col) const;
 
     bool defineName(const QString &name, const QString &formula, const QString &comment=QString(), const QString &scope=QString());
+    StyleId internStyle(const Format &format);
+    StringId internString(const QString &string);
 
     CellRange dimension() const;
 
@@ -119,6 +123,12 @@ public:
     AbstractSheet *currentSheet() const;
     Worksheet *currentWorksheet() const;
 
+    bool isParallelSaveEnabled() const;
+    void setParallelSaveEnabled(bool enable);
+    int compressionLevel() const;
+    void setCompressionLevel(int level);
+    void setCompressionLevel(const QString &partPattern, int level);
+
     bool save() const;
     bool saveAs(const QString &xlsXname) const;
     bool saveAs(QIODevice *device) const;
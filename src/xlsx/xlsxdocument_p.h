@@ -42,6 +42,7 @@
 #include "xlsxcontenttypes_p.h"
 
 #include <QMap>
+#include <QPair>
 
 namespace QXlsx {
 
@@ -62,6 +63,9 @@ public:
     QMap<QString, QString> documentProperties; //core, app and custom properties
     QSharedPointer<Workbook> workbook;
     QSharedPointer<ContentTypes> contentTypes;
+    bool parallelSave;
+    int compressionLevel;
+    QList<QPair<QString, int> > partCompressionLevels;
 };
 
 }
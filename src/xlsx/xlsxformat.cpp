@@ -27,16 +27,66 @@
 #include "xlsxcolor_p.h"
 #include "xlsxnumformatparser_p.h"
 #include <QDataStream>
+#include <QStringList>
 #include <QDebug>
 
 QT_BEGIN_NAMESPACE_XLSX
 
+//The ids must fit in the presence mask of FormatProperties.
+Q_STATIC_ASSERT(FormatPrivate::P_ENDID < 64);
+
+const QVariant *FormatProperties::find(int id) const
+{
+    if (!contains(id))
+        return 0;
+    return &lowerBound(id)->value;
+}
+
+FormatProperties::const_iterator FormatProperties::lowerBound(int id) const
+{
+    const_iterator first = m_properties.constBegin();
+    int count = m_properties.size();
+    while (count > 0) {
+        const int half = count / 2;
+        if (first[half].id < id) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+void FormatProperties::insert(int id, const QVariant &value)
+{
+    Q_ASSERT(id >= 0 && id < 64);
+    const int pos = lowerBound(id) - m_properties.constBegin();
+    if (contains(id)) {
+        m_properties[pos].value = value;
+    } else {
+        Property prop;
+        prop.id = id;
+        prop.value = value;
+        m_properties.insert(pos, prop);
+        m_mask |= Q_UINT64_C(1) << id;
+    }
+}
+
+void FormatProperties::remove(int id)
+{
+    if (!contains(id))
+        return;
+    m_properties.remove(lowerBound(id) - m_properties.constBegin());
+    m_mask &= ~(Q_UINT64_C(1) << id);
+}
+
 FormatPrivate::FormatPrivate()
-    : dirty(true)
-    , font_dirty(true), font_index_valid(false), font_index(0)
-    , fill_dirty(true), fill_index_valid(false), fill_index(0)
-    , border_dirty(true), border_index_valid(false), border_index(0)
-    , xf_index(-1), xf_indexValid(false)
+    : dirty(true), formatHash(0)
+    , font_dirty(true), font_index_valid(false), font_hash(0), font_index(0)
+    , fill_dirty(true), fill_index_valid(false), fill_hash(0), fill_index(0)
+    , border_dirty(true), border_index_valid(false), border_hash(0), border_index(0)
+    , xf_index(-1), xf_indexValid(false), styles_generation(0)
     , is_dxf_fomat(false), dxf_index(-1), dxf_indexValid(false)
     , theme(0)
 {
@@ -44,11 +94,11 @@ FormatPrivate::FormatPrivate()
 
 FormatPrivate::FormatPrivate(const FormatPrivate &other)
     : QSharedData(other)
-    , dirty(other.dirty), formatKey(other.formatKey)
-    , font_dirty(other.font_dirty), font_index_valid(other.font_index_valid), font_key(other.font_key), font_index(other.font_index)
-    , fill_dirty(other.fill_dirty), fill_index_valid(other.fill_index_valid), fill_key(other.fill_key), fill_index(other.fill_index)
-    , border_dirty(other.border_dirty), border_index_valid(other.border_index_valid), border_key(other.border_key), border_index(other.border_index)
-    , xf_index(other.xf_index), xf_indexValid(other.xf_indexValid)
+    , dirty(other.dirty), formatKey(other.formatKey), formatHash(other.formatHash)
+    , font_dirty(other.font_dirty), font_index_valid(other.font_index_valid), font_key(other.font_key), font_hash(other.font_hash), font_index(other.font_index)
+    , fill_dirty(other.fill_dirty), fill_index_valid(other.fill_index_valid), fill_key(other.fill_key), fill_hash(other.fill_hash), fill_index(other.fill_index)
+    , border_dirty(other.border_dirty), border_index_valid(other.border_index_valid), border_key(other.border_key), border_hash(other.border_hash), border_index(other.border_index)
+    , xf_index(other.xf_index), xf_indexValid(other.xf_indexValid), styles_generation(other.styles_generation)
     , is_dxf_fomat(other.is_dxf_fomat), dxf_index(other.dxf_index), dxf_indexValid(other.dxf_indexValid)
     , theme(other.theme)
     , properties(other.properties)
@@ -61,6 +111,118 @@ FormatPrivate::~FormatPrivate()
 
 }
 
+namespace {
+
+template <typename T>
+void appendRaw(QByteArray &key, char tag, T value)
+{
+    key.append(tag);
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void appendString(QByteArray &key, char tag, const QString &string)
+{
+    appendRaw(key, tag, qint32(string.size()));
+    key.append(reinterpret_cast<const char *>(string.constData()), string.size() * sizeof(QChar));
+}
+
+}
+
+/*
+  Builds the key of the properties in [\a firstId, \a lastId). Each
+  property is laid out as its id, a type tag and its value, so that
+  equal properties give the same bytes.
+ */
+void FormatPrivate::makeKey(int firstId, int lastId, QByteArray &key, quint64 &hash) const
+{
+    key.clear();
+    FormatProperties::const_iterator it = properties.lowerBound(firstId);
+    for (; it != properties.constEnd() && it->id < lastId; ++it) {
+        const QVariant &value = it->value;
+        key.append(char(it->id));
+        switch (value.userType()) {
+        case QMetaType::Bool:
+            appendRaw(key, 'b', quint8(value.toBool()));
+            break;
+        case QMetaType::Int:
+            appendRaw(key, 'i', qint32(value.toInt()));
+            break;
+        case QMetaType::Double:
+            appendRaw(key, 'd', value.toDouble());
+            break;
+        case QMetaType::QString:
+            appendString(key, 's', value.toString());
+            break;
+        default:
+            if (value.userType() == qMetaTypeId<XlsxColor>()) {
+                const XlsxColor color = value.value<XlsxColor>();
+                if (color.isRgbColor()) {
+                    appendRaw(key, 'r', quint32(color.rgbColor().rgba()));
+                } else if (color.isIndexedColor()) {
+                    appendRaw(key, 'x', qint32(color.indexedColor()));
+                } else if (color.isThemeColor()) {
+                    const QStringList theme = color.themeColor();
+                    appendString(key, 't', theme.value(0));
+                    appendString(key, 't', theme.value(1));
+                } else {
+                    key.append('n');
+                }
+            } else {
+                //Not expected, but still gives a stable key
+                QByteArray bytes;
+                QDataStream stream(&bytes, QIODevice::WriteOnly);
+                stream << value;
+                appendRaw(key, 'v', qint32(bytes.size()));
+                key.append(bytes);
+            }
+            break;
+        }
+    }
+    hash = hashKey(key);
+}
+
+/*
+  Invalidates the keys and indexes the properties in \a mask belong to.
+ */
+void FormatPrivate::propertiesChanged(quint64 mask)
+{
+    dirty = true;
+    xf_indexValid = false;
+    dxf_indexValid = false;
+    styles_generation = 0;
+
+    if (mask & FormatProperties::rangeMask(P_Font_STARTID, P_Font_ENDID)) {
+        font_dirty = true;
+        font_index_valid = false;
+    }
+    if (mask & FormatProperties::rangeMask(P_Border_STARTID, P_Border_ENDID)) {
+        border_dirty = true;
+        border_index_valid = false;
+    }
+    if (mask & FormatProperties::rangeMask(P_Fill_STARTID, P_Fill_ENDID)) {
+        fill_dirty = true;
+        fill_index_valid = false;
+    }
+}
+
+/*
+  64-bit FNV-1a. The empty key hashes to 0, as the key of an empty
+  format does.
+ */
+quint64 FormatPrivate::hashKey(const QByteArray &key)
+{
+    if (key.isEmpty())
+        return 0;
+
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    const uchar *p = reinterpret_cast<const uchar *>(key.constData());
+    for (int i=0; i<key.size(); ++i) {
+        hash ^= p[i];
+        hash *= Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
 /*!
  * \class Format
  * \inmodule QtXlsx
@@ -527,15 +689,8 @@ QByteArray Format::fontKey() const
         return QByteArray();
 
     if (d->font_dirty) {
-        QByteArray key;
-        QDataStream stream(&key, QIODevice::WriteOnly);
-        for (int i=FormatPrivate::P_Font_STARTID; i<FormatPrivate::P_Font_ENDID; ++i) {
-            if (d->properties.contains(i))
-                stream << i << d->properties[i];
-        };
-
-        const_cast<Format*>(this)->d->font_key = key;
-        const_cast<Format*>(this)->d->font_dirty = false;
+        d->makeKey(FormatPrivate::P_Font_STARTID, FormatPrivate::P_Font_ENDID, d->font_key, d->font_hash);
+        d->font_dirty = false;
     }
 
     return d->font_key;
@@ -550,11 +705,7 @@ bool Format::hasFontData() const
     if (!d)
         return false;
 
-    for (int i=FormatPrivate::P_Font_STARTID; i<FormatPrivate::P_Font_ENDID; ++i) {
-        if (hasProperty(i))
-            return true;
-    }
-    return false;
+    return d->properties.containsAny(FormatPrivate::P_Font_STARTID, FormatPrivate::P_Font_ENDID);
 }
 
 /*!
@@ -691,11 +842,7 @@ bool Format::hasAlignmentData() const
     if (!d)
         return false;
 
-    for (int i=FormatPrivate::P_Alignment_STARTID; i<FormatPrivate::P_Alignment_ENDID; ++i) {
-        if (hasProperty(i))
-            return true;
-    }
-    return false;
+    return d->properties.containsAny(FormatPrivate::P_Alignment_STARTID, FormatPrivate::P_Alignment_ENDID);
 }
 
 /*!
@@ -935,15 +1082,8 @@ QByteArray Format::borderKey() const
         return QByteArray();
 
     if (d->border_dirty) {
-        QByteArray key;
-        QDataStream stream(&key, QIODevice::WriteOnly);
-        for (int i=FormatPrivate::P_Border_STARTID; i<FormatPrivate::P_Border_ENDID; ++i) {
-            if (d->properties.contains(i))
-                stream << i << d->properties[i];
-        };
-
-        const_cast<Format*>(this)->d->border_key = key;
-        const_cast<Format*>(this)->d->border_dirty = false;
+        d->makeKey(FormatPrivate::P_Border_STARTID, FormatPrivate::P_Border_ENDID, d->border_key, d->border_hash);
+        d->border_dirty = false;
     }
 
     return d->border_key;
@@ -958,11 +1098,7 @@ bool Format::hasBorderData() const
     if (!d)
         return false;
 
-    for (int i=FormatPrivate::P_Border_STARTID; i<FormatPrivate::P_Border_ENDID; ++i) {
-        if (hasProperty(i))
-            return true;
-    }
-    return false;
+    return d->properties.containsAny(FormatPrivate::P_Border_STARTID, FormatPrivate::P_Border_ENDID);
 }
 
 /*!
@@ -1055,15 +1191,8 @@ QByteArray Format::fillKey() const
         return QByteArray();
 
     if (d->fill_dirty) {
-        QByteArray key;
-        QDataStream stream(&key, QIODevice::WriteOnly);
-        for (int i=FormatPrivate::P_Fill_STARTID; i<FormatPrivate::P_Fill_ENDID; ++i) {
-            if (d->properties.contains(i))
-                stream << i << d->properties[i];
-        };
-
-        const_cast<Format*>(this)->d->fill_key = key;
-        const_cast<Format*>(this)->d->fill_dirty = false;
+        d->makeKey(FormatPrivate::P_Fill_STARTID, FormatPrivate::P_Fill_ENDID, d->fill_key, d->fill_hash);
+        d->fill_dirty = false;
     }
 
     return d->fill_key;
@@ -1078,11 +1207,7 @@ bool Format::hasFillData() const
     if (!d)
         return false;
 
-    for (int i=FormatPrivate::P_Fill_STARTID; i<FormatPrivate::P_Fill_ENDID; ++i) {
-        if (hasProperty(i))
-            return true;
-    }
-    return false;
+    return d->properties.containsAny(FormatPrivate::P_Fill_STARTID, FormatPrivate::P_Fill_ENDID);
 }
 
 /*!
@@ -1146,11 +1271,23 @@ void Format::mergeFormat(const Format &modifier)
         return;
     }
 
-    QMapIterator<int, QVariant> it(modifier.d->properties);
-    while(it.hasNext()) {
-        it.next();
-        setProperty(it.key(), it.value());
+    if (d == modifier.d)
+        return;
+
+    //Detach once for all the properties which change.
+    const FormatProperties &properties = modifier.d->properties;
+    quint64 changed = 0;
+    for (FormatProperties::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        const QVariant *value = d->properties.find(it->id);
+        if (value && *value == it->value)
+            continue;
+        if (!changed)
+            d.detach();
+        d->properties.insert(it->id, it->value);
+        changed |= Q_UINT64_C(1) << it->id;
     }
+    if (changed)
+        d->propertiesChanged(changed);
 }
 
 /*!
@@ -1182,16 +1319,7 @@ QByteArray Format::formatKey() const
         return QByteArray();
 
     if (d->dirty) {
-        QByteArray key;
-        QDataStream stream(&key, QIODevice::WriteOnly);
-
-        QMapIterator<int, QVariant> i(d->properties);
-        while (i.hasNext()) {
-            i.next();
-            stream<<i.key()<<i.value();
-        }
-
-        d->formatKey = key;
+        d->makeKey(FormatPrivate::P_STARTID, FormatPrivate::P_ENDID, d->formatKey, d->formatHash);
         d->dirty = false;
     }
 
@@ -1290,8 +1418,10 @@ int Format::theme() const
  */
 QVariant Format::property(int propertyId, const QVariant &defaultValue) const
 {
-    if (d && d->properties.contains(propertyId))
-        return d->properties[propertyId];
+    if (d) {
+        if (const QVariant *value = d->properties.find(propertyId))
+            return *value;
+    }
     return defaultValue;
 }
 
@@ -1304,11 +1434,12 @@ void Format::setProperty(int propertyId, const QVariant &value, const QVariant &
         d = new FormatPrivate;
 
     if (value != clearValue) {
-        if (d->properties.contains(propertyId) && d->properties[propertyId] == value)
+        const QVariant *oldValue = d->properties.find(propertyId);
+        if (oldValue && *oldValue == value)
             return;
         if (detach)
             d.detach();
-        d->properties[propertyId] = value;
+        d->properties.insert(propertyId, value);
     } else {
         if (!d->properties.contains(propertyId))
             return;
@@ -1317,20 +1448,7 @@ void Format::setProperty(int propertyId, const QVariant &value, const QVariant &
         d->properties.remove(propertyId);
     }
 
-    d->dirty = true;
-    d->xf_indexValid = false;
-    d->dxf_indexValid = false;
-
-    if (propertyId >= FormatPrivate::P_Font_STARTID && propertyId < FormatPrivate::P_Font_ENDID) {
-        d->font_dirty = true;
-        d->font_index_valid = false;
-    } else if (propertyId >= FormatPrivate::P_Border_STARTID && propertyId < FormatPrivate::P_Border_ENDID) {
-        d->border_dirty = true;
-        d->border_index_valid = false;
-    } else if (propertyId >= FormatPrivate::P_Fill_STARTID && propertyId < FormatPrivate::P_Fill_ENDID) {
-        d->fill_dirty = true;
-        d->fill_index_valid = false;
-    }
+    d->propertiesChanged(Q_UINT64_C(1) << propertyId);
 }
 
 /*!
@@ -1356,10 +1474,11 @@ bool Format::hasProperty(int propertyId) const
  */
 bool Format::boolProperty(int propertyId, bool defaultValue) const
 {
-    if (!hasProperty(propertyId))
+    const QVariant *value = d ? d->properties.find(propertyId) : 0;
+    if (!value)
         return defaultValue;
 
-    const QVariant prop = d->properties[propertyId];
+    const QVariant &prop = *value;
     if (prop.userType() != QMetaType::Bool)
         return defaultValue;
     return prop.toBool();
@@ -1370,10 +1489,11 @@ bool Format::boolProperty(int propertyId, bool defaultValue) const
  */
 int Format::intProperty(int propertyId, int defaultValue) const
 {
-    if (!hasProperty(propertyId))
+    const QVariant *value = d ? d->properties.find(propertyId) : 0;
+    if (!value)
         return defaultValue;
 
-    const QVariant prop = d->properties[propertyId];
+    const QVariant &prop = *value;
     if (prop.userType() != QMetaType::Int)
         return defaultValue;
     return prop.toInt();
@@ -1384,10 +1504,11 @@ int Format::intProperty(int propertyId, int defaultValue) const
  */
 double Format::doubleProperty(int propertyId, double defaultValue) const
 {
-    if (!hasProperty(propertyId))
+    const QVariant *value = d ? d->properties.find(propertyId) : 0;
+    if (!value)
         return defaultValue;
 
-    const QVariant prop = d->properties[propertyId];
+    const QVariant &prop = *value;
     if (prop.userType() != QMetaType::Double && prop.userType() != QMetaType::Float)
         return defaultValue;
     return prop.toDouble();
@@ -1398,10 +1519,11 @@ double Format::doubleProperty(int propertyId, double defaultValue) const
  */
 QString Format::stringProperty(int propertyId, const QString &defaultValue) const
 {
-    if (!hasProperty(propertyId))
+    const QVariant *value = d ? d->properties.find(propertyId) : 0;
+    if (!value)
         return defaultValue;
 
-    const QVariant prop = d->properties[propertyId];
+    const QVariant &prop = *value;
     if (prop.userType() != QMetaType::QString)
         return defaultValue;
     return prop.toString();
@@ -1412,19 +1534,54 @@ QString Format::stringProperty(int propertyId, const QString &defaultValue) cons
  */
 QColor Format::colorProperty(int propertyId, const QColor &defaultValue) const
 {
-    if (!hasProperty(propertyId))
+    const QVariant *value = d ? d->properties.find(propertyId) : 0;
+    if (!value)
         return defaultValue;
 
-    const QVariant prop = d->properties[propertyId];
+    const QVariant &prop = *value;
     if (prop.userType() != qMetaTypeId<XlsxColor>())
         return defaultValue;
     return qvariant_cast<XlsxColor>(prop).rgbColor();
 }
 
+/*!
+ * \class StyleId
+ * \inmodule QtXlsx
+ * \brief Handle of a Format registered with a workbook.
+ *
+ * A StyleId is obtained once per distinct format from
+ * Workbook::internStyle() or Document::internStyle(). Writing cells
+ * with it stores only the style index, which avoids copying and
+ * looking up the Format for each cell.
+ *
+ * A handle is only meaningful for the workbook it was obtained from.
+ */
+
+/*!
+ * \fn StyleId::StyleId()
+ * Constructs an invalid handle.
+ */
+
+/*!
+ * \fn bool StyleId::isValid() const
+ * Returns true if the handle refers to a cell format.
+ */
+
+/*!
+ * \fn int StyleId::xfIndex() const
+ * \internal
+ */
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug dbg, const Format &f)
 {
-    dbg.nospace() << "QXlsx::Format(" << f.d->properties << ")";
+    dbg.nospace() << "QXlsx::Format(";
+    if (f.d) {
+        const FormatProperties &properties = f.d->properties;
+        for (FormatProperties::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it)
+            dbg << "(" << it->id << ", " << it->value << ")";
+    }
+    dbg << ")";
     return dbg.space();
 }
 #endif
@@ -277,6 +277,26 @@ private:
 Q_XLSX_EXPORT QDebug operator<<(QDebug dbg, const Format &f);
 #endif
 
+class StyleId
+{
+public:
+    StyleId() : m_xfIndex(-1) {}
+
+    bool isValid() const { return m_xfIndex >= 0; }
+    int xfIndex() const { return m_xfIndex; }
+
+    bool operator==(const StyleId &other) const { return m_xfIndex == other.m_xfIndex; }
+    bool operator!=(const StyleId &other) const { return m_xfIndex != other.m_xfIndex; }
+
+private:
+    friend class Styles;
+    explicit StyleId(int xfIndex) : m_xfIndex(xfIndex) {}
+
+    int m_xfIndex;
+};
+
 QT_END_NAMESPACE_XLSX
 
+Q_DECLARE_TYPEINFO(QXlsx::StyleId, Q_PRIMITIVE_TYPE);
+
 #endif // QXLSX_FORMAT_H
@@ -40,9 +40,82 @@
 #include <QSharedData>
 #include <QMap>
 #include <QSet>
+#include <QVector>
+#include <QVariant>
 
 namespace QXlsx {
 
+struct FormatProperty
+{
+    int id;
+    QVariant value;
+};
+
+}
+
+Q_DECLARE_TYPEINFO(QXlsx::FormatProperty, Q_MOVABLE_TYPE);
+
+namespace QXlsx {
+
+/*
+  The key Styles uses to find out equal formats, fonts, fills and
+  borders. The 64-bit hash of the key is computed once, and compared
+  before the bytes.
+ */
+struct FormatKey
+{
+    FormatKey() : hash(0) {}
+    FormatKey(const QByteArray &data, quint64 hash) : data(data), hash(hash) {}
+
+    bool operator==(const FormatKey &other) const { return hash == other.hash && data == other.data; }
+    bool operator!=(const FormatKey &other) const { return !(*this == other); }
+
+    QByteArray data;
+    quint64 hash;
+};
+
+inline uint qHash(const FormatKey &key, uint seed = 0)
+{
+    return uint(key.hash) ^ uint(key.hash >> 32) ^ seed;
+}
+
+/*
+  The properties of a format, sorted by id. A format has a handful of
+  properties at most, so a flat vector is cheaper to copy and to walk
+  than a map. The mask has a bit for each property id that is set.
+ */
+class FormatProperties
+{
+public:
+    typedef FormatProperty Property;
+    typedef QVector<Property>::const_iterator const_iterator;
+
+    FormatProperties() : m_mask(0) {}
+
+    bool isEmpty() const { return !m_mask; }
+    int size() const { return m_properties.size(); }
+    quint64 mask() const { return m_mask; }
+    bool contains(int id) const { return id >= 0 && id < 64 && (m_mask & (Q_UINT64_C(1) << id)); }
+    bool containsAny(int firstId, int lastId) const { return m_mask & rangeMask(firstId, lastId); }
+
+    const QVariant *find(int id) const;
+    void insert(int id, const QVariant &value);
+    void remove(int id);
+
+    const_iterator constBegin() const { return m_properties.constBegin(); }
+    const_iterator constEnd() const { return m_properties.constEnd(); }
+    const_iterator lowerBound(int id) const;
+
+    static quint64 rangeMask(int firstId, int lastId)
+    {
+        return ((Q_UINT64_C(1) << lastId) - 1) & ~((Q_UINT64_C(1) << firstId) - 1);
+    }
+
+private:
+    QVector<Property> m_properties;
+    quint64 m_mask;
+};
+
 class FormatPrivate : public QSharedData
 {
 public:
@@ -126,26 +199,35 @@ public:
     FormatPrivate(const FormatPrivate &other);
     ~FormatPrivate();
 
+    void makeKey(int firstId, int lastId, QByteArray &key, quint64 &hash) const;
+    void propertiesChanged(quint64 mask);
+    static quint64 hashKey(const QByteArray &key);
+
     bool dirty; //The key re-generation is need.
     QByteArray formatKey;
+    quint64 formatHash;
 
     bool font_dirty;
     bool font_index_valid;
     QByteArray font_key;
+    quint64 font_hash;
     int font_index;
 
     bool fill_dirty;
     bool fill_index_valid;
     QByteArray fill_key;
+    quint64 fill_hash;
     int fill_index;
 
     bool border_dirty;
     bool border_index_valid;
     QByteArray border_key;
+    quint64 border_hash;
     int border_index;
 
     int xf_index;
     bool xf_indexValid;
+    int styles_generation; //Generation of the Styles the format is registered in, 0 if none.
 
     bool is_dxf_fomat;
     int dxf_index;
@@ -153,7 +235,7 @@ public:
 
     int theme;
 
-    QMap<int, QVariant> properties;
+    FormatProperties properties;
 };
 
 }
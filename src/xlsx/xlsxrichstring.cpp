@@ -339,6 +339,40 @@ uint qHash(const RichString &rs, uint seed) Q_DECL_NOTHROW
     return qHash(rs.d->idKey(), seed);
 }
 
+/*!
+ * \class StringId
+ * \inmodule QtXlsx
+ * \brief Handle of a string registered with a workbook.
+ *
+ * A StringId is obtained once per distinct string from
+ * Workbook::internString(), Worksheet::internString() or
+ * Document::internString(). Writing cells with it only counts the
+ * reference, and the string isn't hashed again for each cell. This
+ * suits columns with a small set of known values.
+ *
+ * A handle is only meaningful for the workbook it was obtained from.
+ */
+
+/*!
+ * \fn StringId::StringId()
+ * Constructs an invalid handle.
+ */
+
+/*!
+ * \fn bool StringId::isValid() const
+ * Returns true if the handle refers to a string.
+ */
+
+/*!
+ * \fn bool StringId::operator==(const StringId &other) const
+ * Returns true if this handle refers to the same string as \a other.
+ */
+
+/*!
+ * \fn bool StringId::operator!=(const StringId &other) const
+ * Returns true if this handle doesn't refer to the same string as \a other.
+ */
+
 #ifndef QT_NO_DEBUG_STREAM
 QDebug operator<<(QDebug dbg, const RichString &rs)
 {
@@ -82,8 +82,26 @@ Q_XLSX_EXPORT bool operator!=(const QString &rs1, const RichString &rs2);
 Q_XLSX_EXPORT QDebug operator<<(QDebug dbg, const RichString &rs);
 #endif
 
+class StringId
+{
+public:
+    StringId() : m_id(-1) {}
+
+    bool isValid() const { return m_id >= 0; }
+
+    bool operator==(const StringId &other) const { return m_id == other.m_id; }
+    bool operator!=(const StringId &other) const { return m_id != other.m_id; }
+
+private:
+    friend class SharedStrings;
+    explicit StringId(int id) : m_id(id) {}
+
+    int m_id;
+};
+
 QT_END_NAMESPACE_XLSX
 
 Q_DECLARE_METATYPE(QXlsx::RichString)
+Q_DECLARE_TYPEINFO(QXlsx::StringId, Q_PRIMITIVE_TYPE);
 
 #endif // XLSXRICHSTRING_H
@@ -41,7 +41,8 @@ namespace QXlsx {
  * duplicated string items may exist in the shared string table.
  *
  * In such case, the size of stringList will larger than stringTable.
- * Duplicated items can be removed once we loaded all the worksheets.
+ * Duplicated items are merged by compact() once all the worksheets
+ * have been loaded.
  */
 
 SharedStrings::SharedStrings(CreateFlag flag)
@@ -60,27 +61,92 @@ bool SharedStrings::isEmpty() const
     return m_stringList.isEmpty();
 }
 
+int SharedStrings::uniqueCount() const
+{
+    return m_stringList.size();
+}
+
+/*
+ * Plain strings are looked up by their text directly, without
+ * building a RichString and its utf8 key.
+ */
 int SharedStrings::addSharedString(const QString &string)
 {
-    return addSharedString(RichString(string));
+    m_stringCount += 1;
+
+    QHash<QString, int>::const_iterator it = m_plainStringTable.constFind(string);
+    if (it != m_plainStringTable.constEnd()) {
+        m_stringRefs[it.value()] += 1;
+        return it.value();
+    }
+
+    int index = m_stringList.size();
+    m_plainStringTable.insert(string, index);
+    m_stringList.append(string);
+    m_stringRefs.append(1);
+    return index;
 }
 
 int SharedStrings::addSharedString(const RichString &string)
 {
+    if (!string.isRichString())
+        return addSharedString(string.toPlainString());
+
     m_stringCount += 1;
 
-    if (m_stringTable.contains(string)) {
-        XlsxSharedStringInfo &item = m_stringTable[string];
-        item.count += 1;
-        return item.index;
+    QHash<RichString, int>::const_iterator it = m_stringTable.constFind(string);
+    if (it != m_stringTable.constEnd()) {
+        m_stringRefs[it.value()] += 1;
+        return it.value();
     }
 
     int index = m_stringList.size();
-    m_stringTable[string] = XlsxSharedStringInfo(index);
-    m_stringList.append(string);
+    m_stringTable.insert(string, index);
+    m_stringList.append(string.toPlainString());
+    m_richStrings.insert(index, string);
+    m_stringRefs.append(1);
+    return index;
+}
+
+/*
+ * Adds a reference to the interned string \a id, without any lookup.
+ * Returns the index of the string, or -1 if \a id is invalid.
+ */
+int SharedStrings::addSharedString(StringId id)
+{
+    if (id.m_id < 0 || id.m_id >= m_internedStrings.size())
+        return -1;
+
+    const int index = m_internedStrings[id.m_id];
+    m_stringRefs[index] += 1;
+    m_stringCount += 1;
     return index;
 }
 
+/*
+ * Returns the handle of the plain \a string. The table holds a reference
+ * to an interned string, which isn't counted as a cell, so that the
+ * item outlives all the cells and the handle stays valid.
+ */
+StringId SharedStrings::intern(const QString &string)
+{
+    int index = getSharedStringIndex(string);
+    if (index >= 0) {
+        QHash<int, int>::const_iterator it = m_stringIds.constFind(index);
+        if (it != m_stringIds.constEnd())
+            return StringId(it.value());
+        m_stringRefs[index] += 1;
+    } else {
+        index = addSharedString(string);
+        m_stringCount -= 1;
+    }
+
+    const int id = m_internedStrings.size();
+    m_internedStrings.append(index);
+    m_stringIds.insert(index, id);
+    return StringId(id);
+}
+
 void SharedStrings::incRefByStringIndex(int idx)
 {
     if (idx <0 || idx >= m_stringList.size()) {
@@ -88,61 +154,144 @@ void SharedStrings::incRefByStringIndex(int idx)
         return;
     }
 
-    addSharedString(m_stringList[idx]);
+    m_stringRefs[idx] += 1;
+    m_stringCount += 1;
 }
 
 /*
- * Broken, don't use.
+ * Called when a cell which uses the item \a idx is overwritten or
+ * removed. The item itself is kept until compact() is called.
  */
-void SharedStrings::removeSharedString(const QString &string)
+void SharedStrings::decRefByStringIndex(int idx)
 {
-    removeSharedString(RichString(string));
+    if (idx <0 || idx >= m_stringList.size() || m_stringRefs[idx] <= 0)
+        return;
+
+    m_stringRefs[idx] -= 1;
+    m_stringCount -= 1;
 }
 
 /*
- * Broken, don't use.
+ * Removes the items which are no longer used, and merges the duplicated
+ * items of loaded files. Returns the new index of each old item, or -1
+ * for the removed ones. The vector is empty if no index has changed.
  */
-void SharedStrings::removeSharedString(const RichString &string)
+QVector<int> SharedStrings::compact()
 {
-    if (!m_stringTable.contains(string))
-        return;
-
-    m_stringCount -= 1;
+    if (!m_stringRefs.contains(0) && m_stringList.size() == m_plainStringTable.size() + m_stringTable.size())
+        return QVector<int>();
+
+    QVector<int> indexMap(m_stringList.size(), -1);
+    QStringList stringList;
+    QHash<int, RichString> richStrings;
+    QVector<int> stringRefs;
+    m_plainStringTable.clear();
+    m_stringTable.clear();
+
+    for (int i=0; i<m_stringList.size(); ++i) {
+        if (!m_stringRefs[i])
+            continue;
+
+        int index = stringList.size();
+        QHash<int, RichString>::const_iterator richIt = m_richStrings.constFind(i);
+        if (richIt != m_richStrings.constEnd()) {
+            QHash<RichString, int>::const_iterator it = m_stringTable.constFind(richIt.value());
+            if (it != m_stringTable.constEnd()) {
+                index = it.value();
+            } else {
+                m_stringTable.insert(richIt.value(), index);
+                richStrings.insert(index, richIt.value());
+            }
+        } else {
+            QHash<QString, int>::const_iterator it = m_plainStringTable.constFind(m_stringList[i]);
+            if (it != m_plainStringTable.constEnd())
+                index = it.value();
+            else
+                m_plainStringTable.insert(m_stringList[i], index);
+        }
 
-    XlsxSharedStringInfo &item = m_stringTable[string];
-    item.count -= 1;
+        if (index == stringList.size()) {
+            stringList.append(m_stringList[i]);
+            stringRefs.append(0);
+        }
+        stringRefs[index] += m_stringRefs[i];
+        indexMap[i] = index;
+    }
 
-    if (item.count <= 0) {
-        for (int i=item.index+1; i<m_stringList.size(); ++i)
-            m_stringTable[m_stringList[i]].index -= 1;
+    m_stringList = stringList;
+    m_richStrings = richStrings;
+    m_stringRefs = stringRefs;
 
-        m_stringList.removeAt(item.index);
-        m_stringTable.remove(string);
+    //The interned items are always used, only their index may change.
+    m_stringIds.clear();
+    for (int id=0; id<m_internedStrings.size(); ++id) {
+        m_internedStrings[id] = indexMap[m_internedStrings[id]];
+        m_stringIds.insert(m_internedStrings[id], id);
     }
+    return indexMap;
+}
+
+/*
+ * Removes a reference to the \a string. The item is removed with the
+ * last one, which moves the indices of the items after it.
+ */
+void SharedStrings::removeSharedString(const QString &string)
+{
+    removeSharedString(RichString(string));
+}
+
+void SharedStrings::removeSharedString(const RichString &string)
+{
+    const int index = getSharedStringIndex(string);
+    if (index < 0)
+        return;
+
+    decRefByStringIndex(index);
+    if (!m_stringRefs[index])
+        compact();
 }
 
 int SharedStrings::getSharedStringIndex(const QString &string) const
 {
-    return getSharedStringIndex(RichString(string));
+    return m_plainStringTable.value(string, -1);
 }
 
 int SharedStrings::getSharedStringIndex(const RichString &string) const
 {
-    if (m_stringTable.contains(string))
-        return m_stringTable[string].index;
-    return -1;
+    if (!string.isRichString())
+        return getSharedStringIndex(string.toPlainString());
+
+    return m_stringTable.value(string, -1);
 }
 
 RichString SharedStrings::getSharedString(int index) const
+{
+    if (index < m_stringList.count() && index >= 0) {
+        QHash<int, RichString>::const_iterator it = m_richStrings.constFind(index);
+        if (it != m_richStrings.constEnd())
+            return it.value();
+        return RichString(m_stringList[index]);
+    }
+    return RichString();
+}
+
+/*
+ * Returns the text of the item at \a index, without any formatting.
+ */
+QString SharedStrings::getSharedPlainString(int index) const
 {
     if (index < m_stringList.count() && index >= 0)
         return m_stringList[index];
-    return RichString();
+    return QString();
 }
 
 QList<RichString> SharedStrings::getSharedStrings() const
 {
-    return m_stringList;
+    QList<RichString> strings;
+    strings.reserve(m_stringList.size());
+    for (int i=0; i<m_stringList.size(); ++i)
+        strings.append(getSharedString(i));
+    return strings;
 }
 
 void SharedStrings::writeRichStringPart_rPr(QXmlStreamWriter &writer, const Format &format) const
@@ -212,7 +361,7 @@ void SharedStrings::saveToXmlFile(QIODevice *device) const
 {
     QXmlStreamWriter writer(device);
 
-    if (m_stringList.size() != m_stringTable.size()) {
+    if (m_stringList.size() != m_plainStringTable.size() + m_stringTable.size()) {
         //Duplicated string items exist in m_stringList
         //Clean up can not be done here, as the indices
         //have been used when we save the worksheets part.
@@ -224,9 +373,11 @@ void SharedStrings::saveToXmlFile(QIODevice *device) const
     writer.writeAttribute(QStringLiteral("count"), QString::number(m_stringCount));
     writer.writeAttribute(QStringLiteral("uniqueCount"), QString::number(m_stringList.size()));
 
-    foreach (RichString string, m_stringList) {
+    for (int idx=0; idx<m_stringList.size(); ++idx) {
         writer.writeStartElement(QStringLiteral("si"));
-        if (string.isRichString()) {
+        QHash<int, RichString>::const_iterator richIt = m_richStrings.constFind(idx);
+        if (richIt != m_richStrings.constEnd()) {
+            const RichString &string = richIt.value();
             //Rich text string
             for (int i=0; i<string.fragmentCount(); ++i) {
                 writer.writeStartElement(QStringLiteral("r"));
@@ -245,7 +396,7 @@ void SharedStrings::saveToXmlFile(QIODevice *device) const
             }
         } else {
             writer.writeStartElement(QStringLiteral("t"));
-            QString pString = string.toPlainString();
+            const QString &pString = m_stringList[idx];
             if (isSpaceReserveNeeded(pString))
                 writer.writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
             writer.writeCharacters(pString);
@@ -275,8 +426,14 @@ void SharedStrings::readString(QXmlStreamReader &reader)
     }
 
     int idx = m_stringList.size();
-    m_stringTable[richString] = XlsxSharedStringInfo(idx, 0);
-    m_stringList.append(richString);
+    if (richString.isRichString()) {
+        m_stringTable[richString] = idx;
+        m_richStrings.insert(idx, richString);
+    } else {
+        m_plainStringTable[richString.toPlainString()] = idx;
+    }
+    m_stringList.append(richString.toPlainString());
+    m_stringRefs.append(0);
 }
 
 void SharedStrings::readRichStringPart(QXmlStreamReader &reader, RichString &richString)
@@ -389,7 +546,7 @@ bool SharedStrings::loadFromXmlFile(QIODevice *device)
         return false;
     }
 
-    if (m_stringList.size() != m_stringTable.size()) {
+    if (m_stringList.size() != m_plainStringTable.size() + m_stringTable.size()) {
         //qDebug("Warning: Duplicated items exist in shared string table.");
         //Nothing we can do here, as indices of the strings will be used when loading sheets.
     }
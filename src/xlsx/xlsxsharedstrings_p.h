@@ -41,6 +41,7 @@
 #include "xlsxabstractooxmlfile.h"
 #include <QHash>
 #include <QStringList>
+#include <QVector>
 #include <QSharedPointer>
 
 class QIODevice;
@@ -49,18 +50,6 @@ class QXmlStreamWriter;
 
 namespace QXlsx {
 
-class XlsxSharedStringInfo
-{
-public:
-    XlsxSharedStringInfo(int index=0, int count = 1) :
-        index(index), count(count)
-    {
-    }
-
-    int index;
-    int count;
-};
-
 class XLSX_AUTOTEST_EXPORT SharedStrings : public AbstractOOXmlFile
 {
 public:
@@ -70,14 +59,20 @@ public:
     
     int addSharedString(const QString &string);
     int addSharedString(const RichString &string);
+    int addSharedString(StringId id);
+    StringId intern(const QString &string);
     void removeSharedString(const QString &string);
     void removeSharedString(const RichString &string);
     void incRefByStringIndex(int idx);
+    void decRefByStringIndex(int idx);
+    QVector<int> compact();
 
     int getSharedStringIndex(const QString &string) const;
     int getSharedStringIndex(const RichString &string) const;
     RichString getSharedString(int index) const;
+    QString getSharedPlainString(int index) const;
     QList<RichString> getSharedStrings() const;
+    int uniqueCount() const;
 
     void saveToXmlFile(QIODevice *device) const;
     bool loadFromXmlFile(QIODevice *device);
@@ -89,8 +84,14 @@ private:
     Format readRichStringPart_rPr(QXmlStreamReader &reader);
     void writeRichStringPart_rPr(QXmlStreamWriter &writer, const Format &format) const;
 
-    QHash<RichString, XlsxSharedStringInfo> m_stringTable; //for fast lookup
-    QList<RichString> m_stringList;
+    //Plain strings, which are most of them, are kept as QString only.
+    QHash<QString, int> m_plainStringTable; //index of the item, for fast lookup
+    QHash<RichString, int> m_stringTable; //rich strings only
+    QStringList m_stringList; //plain text of all the items
+    QHash<int, RichString> m_richStrings; //rich items by index
+    QVector<int> m_stringRefs; //number of cells using each item
+    QVector<int> m_internedStrings; //index of the item, by StringId
+    QHash<int, int> m_stringIds; //StringId of the interned items, by index
     int m_stringCount;
 };
 
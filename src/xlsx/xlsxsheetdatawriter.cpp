@@ -0,0 +1,242 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "xlsxsheetdatawriter_p.h"
+#include "xlsxcellreference_p.h"
+
+#include <QIODevice>
+
+#include <math.h>
+#include <string.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+const int BufferSize = 64 * 1024;
+
+//Longest sequence a single UTF-16 code unit can be written as: "&quot;"
+const int MaxEscapedSize = 6;
+
+/*
+  Writes \a digits / 10^decimals backwards, ending at \a end, without
+  the trailing zeros of the fraction. Returns the start of the text.
+ */
+char *formatDecimal(char *end, quint64 digits, int decimals)
+{
+    while (decimals > 0 && digits % 10 == 0) {
+        digits /= 10;
+        --decimals;
+    }
+
+    char *p = end;
+    for (int i=0; i<decimals; ++i) {
+        *--p = '0' + digits % 10;
+        digits /= 10;
+    }
+    if (decimals)
+        *--p = '.';
+    do {
+        *--p = '0' + digits % 10;
+        digits /= 10;
+    } while (digits);
+    return p;
+}
+
+}
+
+SheetDataWriter::SheetDataWriter(QIODevice *device)
+    : m_device(device), m_buffer(BufferSize, Qt::Uninitialized), m_size(0)
+{
+    m_data = m_buffer.data();
+}
+
+SheetDataWriter::~SheetDataWriter()
+{
+    flush();
+}
+
+void SheetDataWriter::flush()
+{
+    if (m_size) {
+        m_device->write(m_data, m_size);
+        m_size = 0;
+    }
+}
+
+void SheetDataWriter::writeRaw(const char *data, int size)
+{
+    if (m_size + size > BufferSize) {
+        flush();
+        if (size > BufferSize) {
+            m_device->write(data, size);
+            return;
+        }
+    }
+    memcpy(m_data + m_size, data, size);
+    m_size += size;
+}
+
+void SheetDataWriter::writeNumber(qint64 value)
+{
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    quint64 n = value < 0 ? -quint64(value) : quint64(value);
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while (n);
+    if (value < 0)
+        *--p = '-';
+    writeRaw(p, end - p);
+}
+
+/*
+  Same as QString::number(value, 'g', 15).
+ */
+void SheetDataWriter::writeDouble(double value)
+{
+    //Integers below 10^15 are written out in full by the 'g' format.
+    if (value > -1e15 && value < 1e15 && value == floor(value)) {
+        writeNumber(static_cast<qint64>(value));
+        return;
+    }
+
+    //The 'g' format writes the values from 10^-4 on without exponent.
+    //If the value scaled by a power of ten rounds to an integer of at
+    //most 15 digits, it is off by half an ulp at most, which is well
+    //below the 15th significant digit. So the digits of the integer
+    //are the ones the 'g' format gives.
+    const double absValue = fabs(value);
+    if (absValue >= 1e-4 && absValue < 1e15) {
+        double scale = 1;
+        for (int decimals=1; decimals<=22; ++decimals) {
+            scale *= 10;
+            const double scaled = absValue * scale;
+            if (scaled >= 1e15)
+                break;
+            if (scaled == floor(scaled)) {
+                char buf[48];
+                char *end = buf + sizeof(buf);
+                char *p = formatDecimal(end, static_cast<quint64>(scaled), decimals);
+                if (value < 0)
+                    *--p = '-';
+                writeRaw(p, end - p);
+                return;
+            }
+        }
+    }
+
+    const QByteArray number = QByteArray::number(value, 'g', 15);
+    writeRaw(number.constData(), number.size());
+}
+
+void SheetDataWriter::writeCellReference(int row, int col)
+{
+    if (col <= XLSX_COLUMN_MAX) {
+        const ColumnNames *names = ColumnNames::instance();
+        writeRaw(names->names[col - 1], names->lengths[col - 1]);
+    } else {
+        //Past the last column of a sheet, the name isn't in the table.
+        char buf[8];
+        int pos = sizeof(buf);
+        for (int n = col; n > 0; n = (n - 1) / 26)
+            buf[--pos] = 'A' + (n - 1) % 26;
+        writeRaw(buf + pos, sizeof(buf) - pos);
+    }
+    writeNumber(row);
+}
+
+void SheetDataWriter::writeText(const QString &text)
+{
+    writeEscaped(text, false);
+}
+
+void SheetDataWriter::writeAttributeValue(const QString &text)
+{
+    writeEscaped(text, true);
+}
+
+/*
+  Encode \a text as UTF-8. Markup characters are escaped, and so are
+  the whitespace characters in attribute values. Characters that are
+  not allowed in XML are dropped.
+ */
+void SheetDataWriter::writeEscaped(const QString &text, bool attribute)
+{
+    const ushort *p = text.utf16();
+    const ushort *end = p + text.size();
+    for (; p != end; ++p) {
+        if (m_size + MaxEscapedSize > BufferSize)
+            flush();
+        char *out = m_data + m_size;
+        const ushort c = *p;
+        if (c < 0x80) {
+            switch (c) {
+            case '<': memcpy(out, "&lt;", 4); m_size += 4; break;
+            case '>': memcpy(out, "&gt;", 4); m_size += 4; break;
+            case '&': memcpy(out, "&amp;", 5); m_size += 5; break;
+            case '"': memcpy(out, "&quot;", 6); m_size += 6; break;
+            case '\t':
+                if (attribute) { memcpy(out, "&#9;", 4); m_size += 4; } else { *out = c; ++m_size; }
+                break;
+            case '\n':
+                if (attribute) { memcpy(out, "&#10;", 5); m_size += 5; } else { *out = c; ++m_size; }
+                break;
+            case '\r':
+                if (attribute) { memcpy(out, "&#13;", 5); m_size += 5; } else { *out = c; ++m_size; }
+                break;
+            default:
+                if (c >= 0x20) {
+                    *out = c;
+                    ++m_size;
+                }
+                break;
+            }
+        } else if (c < 0x800) {
+            out[0] = 0xc0 | (c >> 6);
+            out[1] = 0x80 | (c & 0x3f);
+            m_size += 2;
+        } else if (QChar::isHighSurrogate(c) && p + 1 != end && QChar::isLowSurrogate(p[1])) {
+            const uint ucs4 = QChar::surrogateToUcs4(c, p[1]);
+            out[0] = 0xf0 | (ucs4 >> 18);
+            out[1] = 0x80 | ((ucs4 >> 12) & 0x3f);
+            out[2] = 0x80 | ((ucs4 >> 6) & 0x3f);
+            out[3] = 0x80 | (ucs4 & 0x3f);
+            m_size += 4;
+            ++p;
+        } else if (c < 0xfffe) {
+            //A lone surrogate becomes the replacement character.
+            const ushort u = QChar::isSurrogate(c) ? 0xfffd : c;
+            out[0] = 0xe0 | (u >> 12);
+            out[1] = 0x80 | ((u >> 6) & 0x3f);
+            out[2] = 0x80 | (u & 0x3f);
+            m_size += 3;
+        }
+    }
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,82 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef QXLSX_XLSXSHEETDATAWRITER_P_H
+#define QXLSX_XLSXSHEETDATAWRITER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+
+QT_BEGIN_NAMESPACE_XLSX
+
+/*
+  Writes the <sheetData> of a worksheet as UTF-8 straight into a
+  buffer, which is flushed to the device whenever it gets full.
+  The caller builds the markup itself, text and attribute values are
+  escaped the same way QXmlStreamWriter does.
+ */
+class XLSX_AUTOTEST_EXPORT SheetDataWriter
+{
+public:
+    explicit SheetDataWriter(QIODevice *device);
+    ~SheetDataWriter();
+
+    void flush();
+
+    void writeRaw(const char *data, int size);
+    template <int N> void writeRaw(const char (&data)[N]) { writeRaw(data, N - 1); }
+    void writeNumber(qint64 value);
+    void writeDouble(double value);
+    void writeCellReference(int row, int col);
+    void writeText(const QString &text);
+    void writeAttributeValue(const QString &text);
+
+private:
+    Q_DISABLE_COPY(SheetDataWriter)
+    void writeEscaped(const QString &text, bool attribute);
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    char *m_data;
+    int m_size;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXSHEETDATAWRITER_P_H
@@ -33,9 +33,16 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QBuffer>
+#include <QAtomicInt>
 
 namespace QXlsx {
 
+/*
+  Each Styles gets its own generation, so that a format registered in
+  one of them isn't taken as registered in another one.
+ */
+static QAtomicInt lastStylesGeneration;
+
 /*
   When loading from existing .xlsx file. we should create a clean styles object.
   otherwise, default formats should be added.
@@ -43,7 +50,7 @@ namespace QXlsx {
 */
 Styles::Styles(CreateFlag flag)
     : AbstractOOXmlFile(flag), m_nextCustomNumFmtId(176), m_isIndexedColorsDefault(true)
-    , m_emptyFormatAdded(false)
+    , m_emptyFormatAdded(false), m_generation(lastStylesGeneration.fetchAndAddRelaxed(1) + 1)
 {
     //!Fix me. Should the custom num fmt Id starts with 164 or 176 or others??
 
@@ -65,7 +72,7 @@ Styles::Styles(CreateFlag flag)
         Format fillFmt;
         fillFmt.setFillPattern(Format::PatternGray125);
         m_fillsList.append(fillFmt);
-        m_fillsHash.insert(fillFmt.fillKey(), fillFmt);
+        m_fillsHash.insert(fillKey(fillFmt), fillFmt);
     }
 }
 
@@ -192,6 +199,10 @@ void Styles::fixNumFmt(const Format &format)
 */
 void Styles::addXfFormat(const Format &format, bool force)
 {
+    //Nothing changed since the format was added last time.
+    if (!force && format.d && format.d->styles_generation == m_generation)
+        return;
+
     if (format.isEmpty()) {
         //Try do something for empty Format.
         if (m_emptyFormatAdded && !force)
@@ -204,58 +215,104 @@ void Styles::addXfFormat(const Format &format, bool force)
         fixNumFmt(format);
 
     //Font
+    const FormatKey font = fontKey(format);
+    QHash<FormatKey, Format>::const_iterator fontIt = m_fontsHash.constFind(font);
     if (format.hasFontData() && !format.fontIndexValid()) {
         //Assign proper font index, if has font data.
-        if (!m_fontsHash.contains(format.fontKey()))
+        if (fontIt == m_fontsHash.constEnd())
             const_cast<Format *>(&format)->setFontIndex(m_fontsList.size());
         else
-            const_cast<Format *>(&format)->setFontIndex(m_fontsHash[format.fontKey()].fontIndex());
+            const_cast<Format *>(&format)->setFontIndex(fontIt->fontIndex());
     }
-    if (!m_fontsHash.contains(format.fontKey())) {
+    if (fontIt == m_fontsHash.constEnd()) {
         //Still a valid font if the format has no fontData. (All font properties are default)
         m_fontsList.append(format);
-        m_fontsHash[format.fontKey()] = format;
+        m_fontsHash.insert(font, format);
     }
 
     //Fill
+    const FormatKey fill = fillKey(format);
+    QHash<FormatKey, Format>::const_iterator fillIt = m_fillsHash.constFind(fill);
     if (format.hasFillData() && !format.fillIndexValid()) {
         //Assign proper fill index, if has fill data.
-        if (!m_fillsHash.contains(format.fillKey()))
+        if (fillIt == m_fillsHash.constEnd())
             const_cast<Format *>(&format)->setFillIndex(m_fillsList.size());
         else
-            const_cast<Format *>(&format)->setFillIndex(m_fillsHash[format.fillKey()].fillIndex());
+            const_cast<Format *>(&format)->setFillIndex(fillIt->fillIndex());
     }
-    if (!m_fillsHash.contains(format.fillKey())) {
+    if (fillIt == m_fillsHash.constEnd()) {
         //Still a valid fill if the format has no fillData. (All fill properties are default)
         m_fillsList.append(format);
-        m_fillsHash[format.fillKey()] = format;
+        m_fillsHash.insert(fill, format);
     }
 
     //Border
+    const FormatKey border = borderKey(format);
+    QHash<FormatKey, Format>::const_iterator borderIt = m_bordersHash.constFind(border);
     if (format.hasBorderData() && !format.borderIndexValid()) {
         //Assign proper border index, if has border data.
-        if (!m_bordersHash.contains(format.borderKey()))
+        if (borderIt == m_bordersHash.constEnd())
             const_cast<Format *>(&format)->setBorderIndex(m_bordersList.size());
         else
-            const_cast<Format *>(&format)->setBorderIndex(m_bordersHash[format.borderKey()].borderIndex());
+            const_cast<Format *>(&format)->setBorderIndex(borderIt->borderIndex());
     }
-    if (!m_bordersHash.contains(format.borderKey())) {
+    if (borderIt == m_bordersHash.constEnd()) {
         //Still a valid border if the format has no borderData. (All border properties are default)
         m_bordersList.append(format);
-        m_bordersHash[format.borderKey()] = format;
+        m_bordersHash.insert(border, format);
     }
 
     //Format
+    const FormatKey xf = xfKey(format);
+    QHash<FormatKey, Format>::const_iterator xfIt = m_xf_formatsHash.constFind(xf);
     if (!format.isEmpty() && !format.xfIndexValid()) {
-        if (m_xf_formatsHash.contains(format.formatKey()))
-            const_cast<Format *>(&format)->setXfIndex(m_xf_formatsHash[format.formatKey()].xfIndex());
+        if (xfIt != m_xf_formatsHash.constEnd())
+            const_cast<Format *>(&format)->setXfIndex(xfIt->xfIndex());
         else
             const_cast<Format *>(&format)->setXfIndex(m_xf_formatsList.size());
     }
-    if (!m_xf_formatsHash.contains(format.formatKey()) || force) {
+    if (xfIt == m_xf_formatsHash.constEnd() || force) {
         m_xf_formatsList.append(format);
-        m_xf_formatsHash[format.formatKey()] = format;
+        m_xf_formatsHash.insert(xf, format);
     }
+
+    if (format.d)
+        format.d->styles_generation = m_generation;
+}
+
+/*
+  Adds the \a format to the cell formats, and returns a handle which
+  the worksheets can store instead of the format itself. Empty formats
+  give an invalid handle.
+ */
+StyleId Styles::intern(const Format &format)
+{
+    addXfFormat(format);
+    return format.isEmpty() ? StyleId() : StyleId(format.xfIndex());
+}
+
+FormatKey Styles::xfKey(const Format &format)
+{
+    const QByteArray key = format.formatKey();
+    return key.isEmpty() ? FormatKey() : FormatKey(key, format.d->formatHash);
+}
+
+FormatKey Styles::fontKey(const Format &format)
+{
+    const QByteArray key = format.fontKey();
+    return key.isEmpty() ? FormatKey() : FormatKey(key, format.d->font_hash);
+}
+
+FormatKey Styles::fillKey(const Format &format)
+{
+    const QByteArray key = format.fillKey();
+    return key.isEmpty() ? FormatKey() : FormatKey(key, format.d->fill_hash);
+}
+
+FormatKey Styles::borderKey(const Format &format)
+{
+    const QByteArray key = format.borderKey();
+    return key.isEmpty() ? FormatKey() : FormatKey(key, format.d->border_hash);
 }
 
 void Styles::addDxfFormat(const Format &format, bool force)
@@ -265,14 +322,14 @@ void Styles::addDxfFormat(const Format &format, bool force)
         fixNumFmt(format);
 
     if (!format.isEmpty() && !format.dxfIndexValid()) {
-        if (m_dxf_formatsHash.contains(format.formatKey()))
-            const_cast<Format *>(&format)->setDxfIndex(m_dxf_formatsHash[format.formatKey()].dxfIndex());
+        if (m_dxf_formatsHash.contains(xfKey(format)))
+            const_cast<Format *>(&format)->setDxfIndex(m_dxf_formatsHash[xfKey(format)].dxfIndex());
         else
             const_cast<Format *>(&format)->setDxfIndex(m_dxf_formatsList.size());
     }
-    if (!m_dxf_formatsHash.contains(format.formatKey()) || force) {
+    if (!m_dxf_formatsHash.contains(xfKey(format)) || force) {
         m_dxf_formatsList.append(format);
-        m_dxf_formatsHash[format.formatKey()] = format;
+        m_dxf_formatsHash[xfKey(format)] = format;
     }
 }
 
@@ -750,7 +807,7 @@ bool Styles::readFonts(QXmlStreamReader &reader)
                 Format format;
                 readFont(reader, format);
                 m_fontsList.append(format);
-                m_fontsHash.insert(format.fontKey(), format);
+                m_fontsHash.insert(fontKey(format), format);
                 if (format.isValid())
                     format.setFontIndex(m_fontsList.size()-1);
             }
@@ -838,7 +895,7 @@ bool Styles::readFills(QXmlStreamReader &reader)
                 Format fill;
                 readFill(reader, fill);
                 m_fillsList.append(fill);
-                m_fillsHash.insert(fill.fillKey(), fill);
+                m_fillsHash.insert(fillKey(fill), fill);
                 if (fill.isValid())
                     fill.setFillIndex(m_fillsList.size()-1);
             }
@@ -932,7 +989,7 @@ bool Styles::readBorders(QXmlStreamReader &reader)
                 Format border;
                 readBorder(reader, border);
                 m_bordersList.append(border);
-                m_bordersHash.insert(border.borderKey(), border);
+                m_bordersHash.insert(borderKey(border), border);
                 if (border.isValid())
                     border.setBorderIndex(m_bordersList.size()-1);
             }
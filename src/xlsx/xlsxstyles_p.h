@@ -38,6 +38,7 @@
 
 #include "xlsxglobal.h"
 #include "xlsxformat.h"
+#include "xlsxformat_p.h"
 #include "xlsxabstractooxmlfile.h"
 #include <QSharedPointer>
 #include <QHash>
@@ -70,6 +71,7 @@ public:
     Styles(CreateFlag flag);
     ~Styles();
     void addXfFormat(const Format &format, bool force=false);
+    StyleId intern(const Format &format);
     Format xfFormat(int idx) const;
     void addDxfFormat(const Format &format, bool force=false);
     Format dxfFormat(int idx) const;
@@ -85,6 +87,11 @@ private:
 
     void fixNumFmt(const Format &format);
 
+    static FormatKey xfKey(const Format &format);
+    static FormatKey fontKey(const Format &format);
+    static FormatKey fillKey(const Format &format);
+    static FormatKey borderKey(const Format &format);
+
     void writeNumFmts(QXmlStreamWriter &writer) const;
     void writeFonts(QXmlStreamWriter &writer) const;
     void writeFont(QXmlStreamWriter &writer, const Format &font, bool isDxf = false) const;
@@ -119,20 +126,21 @@ private:
     QList<Format> m_fontsList;
     QList<Format> m_fillsList;
     QList<Format> m_bordersList;
-    QHash<QByteArray, Format> m_fontsHash;
-    QHash<QByteArray, Format> m_fillsHash;
-    QHash<QByteArray, Format> m_bordersHash;
+    QHash<FormatKey, Format> m_fontsHash;
+    QHash<FormatKey, Format> m_fillsHash;
+    QHash<FormatKey, Format> m_bordersHash;
 
     QVector<QColor> m_indexedColors;
     bool m_isIndexedColorsDefault;
 
     QList<Format> m_xf_formatsList;
-    QHash<QByteArray, Format> m_xf_formatsHash;
+    QHash<FormatKey, Format> m_xf_formatsHash;
 
     QList<Format> m_dxf_formatsList;
-    QHash<QByteArray, Format> m_dxf_formatsHash;
+    QHash<FormatKey, Format> m_dxf_formatsHash;
 
     bool m_emptyFormatAdded;
+    int m_generation;
 };
 
 }
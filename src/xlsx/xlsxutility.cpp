@@ -112,6 +112,106 @@ QDateTime datetimeFromNumber(double num, bool is1904)
     return dt;
 }
 
+/*
+  The batch conversions below work on the wall clock time, without
+  time zones, so that each one is plain arithmetic which the compiler
+  can vectorize. Epoch milliseconds are taken as UTC.
+ */
+namespace {
+
+const qint64 MSecsPerDay = 86400000;
+
+//Days from the epoch of the date system to 1970-01-01.
+qint64 unixEpochDay(bool is1904)
+{
+    return is1904 ? 24107 : 25568;
+}
+
+qint64 epochJulianDay(bool is1904)
+{
+    return is1904 ? QDate(1904, 1, 1).toJulianDay() : QDate(1899, 12, 31).toJulianDay();
+}
+
+//Account for Excel erroneously treating 1900 as a leap year.
+void addLeapDay1900(double *numbers, int count)
+{
+    for (int i=0; i<count; ++i)
+        numbers[i] += numbers[i] > 59 ? 1 : 0;
+}
+
+}
+
+/*
+  Converts the \a count times at \a msecs, in milliseconds since
+  1970-01-01T00:00:00 UTC, to the serial numbers used by Excel.
+ */
+void datetimesToNumbers(const qint64 *msecs, double *numbers, int count, bool is1904)
+{
+    const double epochDay = unixEpochDay(is1904);
+    for (int i=0; i<count; ++i)
+        numbers[i] = msecs[i] / double(MSecsPerDay) + epochDay;
+    if (!is1904)
+        addLeapDay1900(numbers, count);
+}
+
+/*
+  Converts the \a count \a datetimes to the serial numbers used by
+  Excel. The numbers are the local date and time of the \a datetimes
+  as read on a wall clock, which is what Excel stores. This isn't
+  always the same as datetimeToNumber(), which counts the milliseconds
+  elapsed since the epoch in the local time zone and only corrects
+  them by one hour during daylight saving time. The \a datetimes must
+  be valid, the number of an invalid one is meaningless.
+ */
+void datetimesToNumbers(const QDateTime *datetimes, double *numbers, int count, bool is1904)
+{
+    const qint64 epochDay = epochJulianDay(is1904);
+    for (int i=0; i<count; ++i) {
+        const QDateTime &dt = datetimes[i];
+        const QDateTime local = dt.timeSpec() == Qt::LocalTime ? dt : dt.toLocalTime();
+        numbers[i] = (local.date().toJulianDay() - epochDay)
+                + local.time().msecsSinceStartOfDay() / double(MSecsPerDay);
+    }
+    if (!is1904)
+        addLeapDay1900(numbers, count);
+}
+
+/*
+  Converts the \a count serial \a numbers to times in milliseconds
+  since 1970-01-01T00:00:00 UTC.
+ */
+void datetimesFromNumbers(const double *numbers, qint64 *msecs, int count, bool is1904)
+{
+    const qint64 epochMSecs = unixEpochDay(is1904) * MSecsPerDay;
+    for (int i=0; i<count; ++i) {
+        const double num = !is1904 && numbers[i] > 60 ? numbers[i] - 1 : numbers[i];
+        msecs[i] = static_cast<qint64>(num * MSecsPerDay + 0.5) - epochMSecs;
+    }
+}
+
+/*
+  Converts the \a count serial \a numbers to local date times which
+  show the same wall clock time, the reverse of the conversion of
+  QDateTime values above. The results may differ from the ones of
+  datetimeFromNumber() for the same reasons.
+ */
+void datetimesFromNumbers(const double *numbers, QDateTime *datetimes, int count, bool is1904)
+{
+    const qint64 epochDay = epochJulianDay(is1904);
+    for (int i=0; i<count; ++i) {
+        const double num = !is1904 && numbers[i] > 60 ? numbers[i] - 1 : numbers[i];
+        const qint64 msecs = static_cast<qint64>(num * MSecsPerDay + 0.5);
+        qint64 day = msecs / MSecsPerDay;
+        qint64 msecsOfDay = msecs % MSecsPerDay;
+        if (msecsOfDay < 0) {
+            --day;
+            msecsOfDay += MSecsPerDay;
+        }
+        datetimes[i] = QDateTime(QDate::fromJulianDay(epochDay + day),
+                                 QTime::fromMSecsSinceStartOfDay(static_cast<int>(msecsOfDay)));
+    }
+}
+
 /*
   Creates a valid sheet name
     minimum length is 1
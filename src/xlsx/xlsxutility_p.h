@@ -55,6 +55,10 @@ XLSX_AUTOTEST_EXPORT QString getRelFilePath(const QString &filePath);
 XLSX_AUTOTEST_EXPORT double datetimeToNumber(const QDateTime &dt, bool is1904=false);
 XLSX_AUTOTEST_EXPORT QDateTime datetimeFromNumber(double num, bool is1904=false);
 XLSX_AUTOTEST_EXPORT double timeToNumber(const QTime &t);
+XLSX_AUTOTEST_EXPORT void datetimesToNumbers(const qint64 *msecs, double *numbers, int count, bool is1904=false);
+XLSX_AUTOTEST_EXPORT void datetimesToNumbers(const QDateTime *datetimes, double *numbers, int count, bool is1904=false);
+XLSX_AUTOTEST_EXPORT void datetimesFromNumbers(const double *numbers, qint64 *msecs, int count, bool is1904=false);
+XLSX_AUTOTEST_EXPORT void datetimesFromNumbers(const double *numbers, QDateTime *datetimes, int count, bool is1904=false);
 
 XLSX_AUTOTEST_EXPORT QString createSafeSheetName(const QString &nameProposal);
 XLSX_AUTOTEST_EXPORT QString escapeSheetName(const QString &sheetName);
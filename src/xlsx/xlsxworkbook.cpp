@@ -69,6 +69,7 @@ WorkbookPrivate::WorkbookPrivate(Workbook *q, Workbook::CreateFlag flag) :
     strings_to_numbers_enabled = false;
     strings_to_hyperlinks_enabled = true;
     html_to_richstring_enabled = false;
+    string_storage_policy = Workbook::SharedStringStorage;
     date1904 = false;
     defaultDateFormat = QStringLiteral("yyyy-mm-dd");
     activesheetIndex = 0;
@@ -155,6 +156,43 @@ bool Workbook::isHtmlToRichStringEnabled() const
     return d->html_to_richstring_enabled;
 }
 
+/*!
+  \enum Workbook::StringStoragePolicy
+
+  \value SharedStringStorage The strings are stored in the shared string table.
+  \value InlineStringStorage The strings are stored in the cells, as inline strings.
+  \value AdaptiveStringStorage The strings of a column are stored in the
+          shared string table, until it turns out that they are mostly unique.
+          The following strings of the column are stored as inline strings.
+*/
+
+/*!
+  Returns how the strings written by Worksheet::write() are stored.
+
+  \sa setStringStoragePolicy()
+*/
+Workbook::StringStoragePolicy Workbook::stringStoragePolicy() const
+{
+    Q_D(const Workbook);
+    return d->string_storage_policy;
+}
+
+/*!
+  Sets how the strings written by Worksheet::write() are stored to
+  \a policy. Sharing a string which appears once costs memory and a
+  lookup, while columns of ids or free text rarely repeat a value.
+
+  Worksheet::writeString() and Worksheet::writeInlineString() aren't
+  affected.
+
+  The default is SharedStringStorage.
+*/
+void Workbook::setStringStoragePolicy(StringStoragePolicy policy)
+{
+    Q_D(Workbook);
+    d->string_storage_policy = policy;
+}
+
 QString Workbook::defaultDateFormat() const
 {
     Q_D(const Workbook);
@@ -167,6 +205,36 @@ void Workbook::setDefaultDateFormat(const QString &format)
     d->defaultDateFormat = format;
 }
 
+/*!
+ * Registers the \a format with the workbook and returns its handle.
+ *
+ * A cell written with the handle only stores the style index, and
+ * the format isn't looked up again for each cell.
+ *
+ * \sa Worksheet::writeNumeric()
+ */
+StyleId Workbook::internStyle(const Format &format)
+{
+    Q_D(Workbook);
+    return d->styles->intern(format);
+}
+
+/*!
+ * Registers the plain text \a string with the shared string table of
+ * the workbook and returns its handle. Interning the same string again
+ * returns the same handle.
+ *
+ * A cell written with the handle only stores the string index. The
+ * string is kept in the table as long as the workbook exists.
+ *
+ * \sa Worksheet::writeString()
+ */
+StringId Workbook::internString(const QString &string)
+{
+    Q_D(Workbook);
+    return d->sharedStrings->intern(string);
+}
+
 /*!
  * \brief Create a defined name in the workbook.
  * \param name The defined name
@@ -348,6 +416,8 @@ bool Workbook::deleteSheet(int index)
         return false;
     if (index < 0 || index >= d->sheets.size())
         return false;
+    if (d->sheets[index]->sheetType() == AbstractSheet::ST_WorkSheet)
+        static_cast<Worksheet *>(d->sheets[index].data())->d_func()->releaseStrings();
     d->sheets.removeAt(index);
     d->sheetNames.removeAt(index);
     return true;
@@ -396,8 +466,10 @@ bool Workbook::copySheet(int index, const QString &newName)
         } while (d->sheetNames.contains(worksheetName));
     }
 
+    AbstractSheet *sheet = d->sheets[index]->copy(worksheetName, d->last_sheet_id + 1);
+    if (!sheet)
+        return false;
     ++d->last_sheet_id;
-    AbstractSheet *sheet = d->sheets[index]->copy(worksheetName, d->last_sheet_id);
     d->sheets.append(QSharedPointer<AbstractSheet> (sheet));
     d->sheetNames.append(sheet->sheetName());
 
@@ -430,6 +502,33 @@ SharedStrings *Workbook::sharedStrings() const
     return d->sharedStrings.data();
 }
 
+/*!
+ * \internal
+ *
+ * Drops the shared strings no cell uses any more, and updates the
+ * indices the worksheets keep. Nothing is done if a worksheet has
+ * streamed rows out already, as their indices can't be changed.
+ */
+void Workbook::compactSharedStrings()
+{
+    Q_D(Workbook);
+    QList<WorksheetPrivate *> worksheets;
+    foreach (QSharedPointer<AbstractSheet> sheet, d->sheets) {
+        if (sheet->sheetType() != AbstractSheet::ST_WorkSheet)
+            continue;
+        WorksheetPrivate *sheet_d = static_cast<Worksheet *>(sheet.data())->d_func();
+        if (sheet_d->streamFile)
+            return;
+        worksheets.append(sheet_d);
+    }
+
+    const QVector<int> indexMap = d->sharedStrings->compact();
+    if (indexMap.isEmpty())
+        return;
+    foreach (WorksheetPrivate *sheet_d, worksheets)
+        sheet_d->remapStrings(indexMap);
+}
+
 Styles *Workbook::styles()
 {
     Q_D(Workbook);
@@ -29,6 +29,8 @@
 #include "xlsxabstractooxmlfile.h"
 #include "xlsxabstractsheet.h"
 #include "xlsxcellrange.h"
+#include "xlsxformat.h"
+#include "xlsxrichstring.h"
 #include <QList>
 #include <QImage>
 #include <QSharedPointer>
@@ -76,6 +78,12 @@ class Q_XLSX_EXPORT Workbook : public AbstractOOXmlFile
 {
     Q_DECLARE_PRIVATE(Workbook)
 public:
+    enum StringStoragePolicy {
+        SharedStringStorage,
+        InlineStringStorage,
+        AdaptiveStringStorage
+    };
+
     ~Workbook();
 
     int sheetCount() const;
@@ -103,8 +111,12 @@ public:
     void setStringsToHyperlinksEnabled(bool enable=true);
     bool isHtmlToRichStringEnabled() const;
     void setHtmlToRichStringEnabled(bool enable=true);
+    StringStoragePolicy stringStoragePolicy() const;
+    void setStringStoragePolicy(StringStoragePolicy policy);
     QString defaultDateFormat() const;
     void setDefaultDateFormat(const QString &format);
+    StyleId internStyle(const Format &format);
+    StringId internString(const QString &string);
 
     //internal used member
     void addMediaFile(QSharedPointer<MediaFile> media, bool force=false);
@@ -125,6 +137,7 @@ private:
     bool loadFromXmlFile(QIODevice *device);
 
     SharedStrings *sharedStrings() const;
+    void compactSharedStrings();
     Styles *styles();
     Theme *theme();
     QList<QImage> images();
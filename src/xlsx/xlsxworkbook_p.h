@@ -67,6 +67,7 @@ public:
     bool strings_to_numbers_enabled;
     bool strings_to_hyperlinks_enabled;
     bool html_to_richstring_enabled;
+    Workbook::StringStoragePolicy string_storage_policy;
     bool date1904;
     QString defaultDateFormat;
 
@@ -41,6 +41,7 @@
 #include "xlsxchart.h"
 #include "xlsxcellformula.h"
 #include "xlsxcellformula_p.h"
+#include "xlsxsheetdatawriter_p.h"
 
 #include <QVariant>
 #include <QDateTime>
@@ -54,6 +55,7 @@
 #include <QXmlStreamReader>
 #include <QTextDocument>
 #include <QDir>
+#include <QTemporaryFile>
 
 #include <math.h>
 
@@ -71,6 +73,9 @@ WorksheetPrivate::WorksheetPrivate(Worksheet *p, Worksheet::CreateFlag flag)
 {
     previous_row = 0;
 
+    streamingWindow = 0;
+    streamedRow = 0;
+
     outline_row_level = 0;
     outline_col_level = 0;
 
@@ -87,51 +92,36 @@ WorksheetPrivate::~WorksheetPrivate()
   XLSX optimisation and isn't strictly required. However, it
   makes comparing files easier. The span is the same for each
   block of 16 rows.
+
+  The cell table keeps the columns of a block sorted and drops the
+  empty ones as cells are written, removed or loaded, so the span of
+  a block is given by its first and last column.
  */
-void WorksheetPrivate::calculateSpans() const
+void WorksheetPrivate::calculateSpans(int firstRow, int lastRow) const
 {
     row_spans.clear();
-    int span_min = XLSX_COLUMN_MAX+1;
-    int span_max = -1;
-
-    for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        if (cellTable.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn(); col_num++) {
-                if (cellTable[row_num].contains(col_num)) {
-                    if (span_max == -1) {
-                        span_min = col_num;
-                        span_max = col_num;
-                    } else {
-                        if (col_num < span_min)
-                            span_min = col_num;
-                        else if (col_num > span_max)
-                            span_max = col_num;
-                    }
-                }
-            }
-        }
-        if (comments.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn(); col_num++) {
-                if (comments[row_num].contains(col_num)) {
-                    if (span_max == -1) {
-                        span_min = col_num;
-                        span_max = col_num;
-                    } else {
-                        if (col_num < span_min)
-                            span_min = col_num;
-                        else if (col_num > span_max)
-                            span_max = col_num;
-                    }
-                }
-            }
-        }
 
-        if (row_num%16 == 0 || row_num == dimension.lastRow()) {
-            if (span_max != -1) {
-                row_spans[row_num / 16] = QStringLiteral("%1:%2").arg(span_min).arg(span_max);
-                span_min = XLSX_COLUMN_MAX+1;
-                span_max = -1;
-            }
+    const int firstBlock = (firstRow-1) / CellTable::BlockRows;
+    const int lastBlock = qMin((lastRow-1) / CellTable::BlockRows, cellTable.blockCount() - 1);
+    for (int i = firstBlock; i <= lastBlock; ++i) {
+        const CellTable::Block *block = cellTable.block(i);
+        if (!block->columns.isEmpty())
+            row_spans.insert(i, qMakePair(block->columns.first().column, block->columns.last().column));
+    }
+
+    QMap<int, QMap<int, QString> >::const_iterator it = comments.lowerBound(firstRow);
+    for (; it != comments.constEnd() && it.key() <= lastRow; ++it) {
+        if (it->isEmpty())
+            continue;
+        //Keyed the same way saveXmlSheetData() looks it up, so that
+        //each row gets the span of its own block.
+        const int span_index = (it.key()-1) / CellTable::BlockRows;
+        QMap<int, QPair<int, int> >::iterator span = row_spans.find(span_index);
+        if (span == row_spans.end()) {
+            row_spans.insert(span_index, qMakePair(it->firstKey(), it->lastKey()));
+        } else {
+            span->first = qMin(span->first, it->firstKey());
+            span->second = qMax(span->second, it->lastKey());
         }
     }
 }
@@ -160,6 +150,10 @@ int WorksheetPrivate::checkDimensions(int row, int col, bool ignore_row, bool ig
     if (row > XLSX_ROW_MAX || row < 1 || col > XLSX_COLUMN_MAX || col < 1)
         return -1;
 
+    //Rows that have been streamed out can't be changed any more.
+    if (!ignore_row && row <= streamedRow)
+        return -1;
+
     if (!ignore_row) {
         if (row < dimension.firstRow() || dimension.firstRow() == -1) dimension.setFirstRow(row);
         if (row > dimension.lastRow()) dimension.setLastRow(row);
@@ -172,6 +166,140 @@ int WorksheetPrivate::checkDimensions(int row, int col, bool ignore_row, bool ig
     return 0;
 }
 
+/*
+  In streaming mode, serialize the rows which have fallen out of
+  the window into a temporary file and release them. Only whole
+  blocks of 16 rows are streamed out, so that the "spans" of a
+  block can still be calculated from the cells kept in memory.
+*/
+void WorksheetPrivate::streamRows(int row)
+{
+    if (streamingWindow <= 0)
+        return;
+
+    int lastRow = (row - streamingWindow) / 16 * 16;
+    if (lastRow <= streamedRow)
+        return;
+
+    if (!streamFile) {
+        streamFile.reset(new QTemporaryFile);
+        if (!streamFile->open()) {
+            qWarning("Can not create the temporary file used by the streaming mode.");
+            streamFile.reset();
+            streamingWindow = 0;
+            return;
+        }
+    }
+
+    saveXmlSheetData(streamFile.data(), qMax(streamedRow + 1, dimension.firstRow()), lastRow);
+
+    cellTable.removeRows(lastRow);
+    while (!comments.isEmpty() && comments.firstKey() <= lastRow)
+        comments.erase(comments.begin());
+    while (!rowsInfo.isEmpty() && rowsInfo.firstKey() <= lastRow)
+        rowsInfo.erase(rowsInfo.begin());
+
+    streamedRow = lastRow;
+}
+
+/*
+  Write the string \a value the way the string storage policy of
+  the workbook says.
+
+  The adaptive policy shares the first strings of a column. If few
+  of them were shared already, the column is unique-heavy and its
+  next strings are written as inline strings.
+*/
+bool WorksheetPrivate::writeStringByPolicy(int row, int column, const QString &value, const Format &format)
+{
+    Q_Q(Worksheet);
+    const Workbook::StringStoragePolicy policy = workbook->stringStoragePolicy();
+    if (policy == Workbook::SharedStringStorage
+            || (workbook->isHtmlToRichStringEnabled() && Qt::mightBeRichText(value))) {
+        return q->writeString(row, column, value, format);
+    }
+    if (policy == Workbook::InlineStringStorage)
+        return q->writeInlineString(row, column, value, format);
+
+    const int sampleSize = 1024;
+    XlsxStringColumnStats &stats = stringColumnStats[column];
+    if (stats.inlineStrings)
+        return q->writeInlineString(row, column, value, format);
+
+    const int uniqueCount = sharedStrings()->uniqueCount();
+    if (!q->writeString(row, column, value, format))
+        return false;
+
+    if (stats.strings < sampleSize) {
+        ++stats.strings;
+        if (sharedStrings()->uniqueCount() == uniqueCount)
+            ++stats.hits;
+        //Less than one string in four has been shared.
+        if (stats.strings == sampleSize && stats.hits * 4 < sampleSize)
+            stats.inlineStrings = true;
+    }
+    return true;
+}
+
+/*
+  Drop the reference the cell (\a row, \a col) holds on a shared
+  string, before the cell is overwritten.
+*/
+void WorksheetPrivate::releaseString(int row, int col)
+{
+    const CellTable::CellKind kind = cellTable.kind(row, col);
+    if (kind == CellTable::StringCell) {
+        sharedStrings()->decRefByStringIndex(cellTable.stringIndex(row, col));
+    } else if (kind == CellTable::ObjectCell) {
+        const CellPrivate *d = cellTable.cell(row, col)->d_ptr;
+        if (d->cellType == Cell::SharedStringType)
+            sharedStrings()->decRefByStringIndex(d->sharedStringIndex);
+    }
+}
+
+/*
+  Drop the references all the cells hold on shared strings, when
+  the sheet is removed from the workbook.
+*/
+void WorksheetPrivate::releaseStrings()
+{
+    for (int i=0; i<cellTable.blockCount(); ++i) {
+        const CellTable::Block *block = cellTable.block(i);
+        for (int j=0; j<block->columns.size(); ++j) {
+            const CellTable::Column &column = block->columns[j];
+            for (int k=0; k<column.cells.size(); ++k) {
+                if (column.cells[k].kind == CellTable::StringCell)
+                    sharedStrings()->decRefByStringIndex(column.cells[k].index);
+            }
+        }
+    }
+
+    QHashIterator<quint64, QSharedPointer<Cell> > it(cellTable.cells());
+    while (it.hasNext()) {
+        it.next();
+        const CellPrivate *d = it.value()->d_ptr;
+        if (d->cellType == Cell::SharedStringType)
+            sharedStrings()->decRefByStringIndex(d->sharedStringIndex);
+    }
+}
+
+/*
+  Update the shared string indices of the cells after the shared
+  strings have been compacted.
+*/
+void WorksheetPrivate::remapStrings(const QVector<int> &indexMap)
+{
+    cellTable.remapStrings(indexMap);
+
+    QHashIterator<quint64, QSharedPointer<Cell> > it(cellTable.cells());
+    while (it.hasNext()) {
+        it.next();
+        CellPrivate *d = it.value()->d_ptr;
+        if (d->cellType == Cell::SharedStringType && d->sharedStringIndex >= 0)
+            d->sharedStringIndex = indexMap.value(d->sharedStringIndex, -1);
+    }
+}
+
 /*!
   \class Worksheet
   \inmodule QtXlsx
@@ -191,7 +319,8 @@ Worksheet::Worksheet(const QString &name, int id, Workbook *workbook, CreateFlag
 /*!
  * \internal
  *
- * Make a copy of this sheet.
+ * Make a copy of this sheet. Returns 0 if the rows the sheet has
+ * streamed out can't be copied.
  */
 
 Worksheet *Worksheet::copy(const QString &distName, int distId) const
@@ -202,23 +331,53 @@ Worksheet *Worksheet::copy(const QString &distName, int distId) const
 
     sheet_d->dimension = d->dimension;
 
-    QMapIterator<int, QMap<int, QSharedPointer<Cell> > > it(d->cellTable);
+    //The rows streamed out already are copied into a temporary file of
+    //the new sheet. The shared strings they use are never released by
+    //the source sheet, and aren't compacted while rows are streamed.
+    sheet_d->streamingWindow = d->streamingWindow;
+    if (d->streamFile) {
+        sheet_d->streamFile.reset(new QTemporaryFile);
+        if (!sheet_d->streamFile->open()) {
+            qWarning("Can not create the temporary file used by the streaming mode.");
+            delete sheet;
+            return 0;
+        }
+        d->streamFile->flush();
+        qint64 pos = d->streamFile->pos();
+        d->streamFile->seek(0);
+        while (!d->streamFile->atEnd())
+            sheet_d->streamFile->write(d->streamFile->read(64 * 1024));
+        d->streamFile->seek(pos);
+        sheet_d->streamedRow = d->streamedRow;
+    }
+
+    //The typed cells are copied as they are, the Cell objects are cloned.
+    sheet_d->cellTable = d->cellTable;
+    for (int i=0; i<d->cellTable.blockCount(); ++i) {
+        const CellTable::Block *block = d->cellTable.block(i);
+        for (int j=0; j<block->columns.size(); ++j) {
+            const CellTable::Column &column = block->columns[j];
+            for (int k=0; k<column.cells.size(); ++k) {
+                if (column.cells[k].kind == CellTable::StringCell)
+                    d->workbook->sharedStrings()->incRefByStringIndex(column.cells[k].index);
+            }
+        }
+    }
+
+    QHashIterator<quint64, QSharedPointer<Cell> > it(d->cellTable.cells());
     while (it.hasNext()) {
         it.next();
-        int row = it.key();
-        QMapIterator<int, QSharedPointer<Cell> > it2(it.value());
-        while (it2.hasNext()) {
-            it2.next();
-            int col = it2.key();
+        QSharedPointer<Cell> cell(new Cell(it.value().data()));
+        cell->d_ptr->parent = sheet;
 
-            QSharedPointer<Cell> cell(new Cell(it2.value().data()));
-            cell->d_ptr->parent = sheet;
-
-            if (cell->cellType() == Cell::SharedStringType)
+        if (cell->cellType() == Cell::SharedStringType) {
+            if (cell->d_ptr->sharedStringIndex >= 0)
+                d->workbook->sharedStrings()->incRefByStringIndex(cell->d_ptr->sharedStringIndex);
+            else
                 d->workbook->sharedStrings()->addSharedString(cell->d_ptr->richString);
-
-            sheet_d->cellTable[row][col] = cell;
         }
+
+        sheet_d->cellTable.setCell(CellTable::keyRow(it.key()), CellTable::keyColumn(it.key()), cell);
     }
 
     sheet_d->merges = d->merges;
@@ -421,6 +580,36 @@ void Worksheet::setWhiteSpaceVisible(bool visible)
     d->showWhiteSpace = visible;
 }
 
+/*!
+ * Returns the number of rows kept in memory when the streaming mode
+ * is enabled, or 0 if the streaming mode is disabled.
+ *
+ * \sa setStreamingWindow()
+ */
+int Worksheet::streamingWindow() const
+{
+    Q_D(const Worksheet);
+    return d->streamingWindow;
+}
+
+/*!
+ * Enables the streaming mode if \a rows is greater than 0, disables it otherwise.
+ *
+ * In streaming mode only the last \a rows rows (rounded to blocks of 16 rows)
+ * before the last written row are kept in memory. Older rows are serialized into
+ * a temporary file, which is spliced into the sheet when the document is saved,
+ * so the memory used by the sheet doesn't grow with the number of rows written.
+ *
+ * Rows should be written in ascending order. Once a row has been streamed out,
+ * writing to it fails and cellAt() returns 0 for its cells. Row and column
+ * formats which affect the streamed rows must be set before they are written.
+ */
+void Worksheet::setStreamingWindow(int rows)
+{
+    Q_D(Worksheet);
+    d->streamingWindow = rows > 0 ? rows : 0;
+}
+
 /*!
  * Write \a value to cell (\a row, \a column) with the \a format.
  * Both \a row and \a column are all 1-indexed value.
@@ -454,7 +643,7 @@ bool Worksheet::write(int row, int column, const QVariant &value, const Format &
             ret = writeString(row, column, value.toString(), format);
         } else {
             //normal string now
-            ret = writeString(row, column, token, format);
+            ret = d->writeStringByPolicy(row, column, token, format);
         }
     } else if (value.userType() == qMetaTypeId<RichString>()) {
         ret = writeString(row, column, value.value<RichString>(), format);
@@ -499,6 +688,181 @@ bool Worksheet::write(const CellReference &row_column, const QVariant &value, co
     return write(row_column.row(), row_column.column(), value, format);
 }
 
+/*
+  Checks the \a count cells of the row \a row from the column
+  \a firstColumn on, and stores the dimension, the same way
+  checkDimensions() does for a single cell.
+ */
+bool WorksheetPrivate::checkRowDimensions(int row, int firstColumn, int count)
+{
+    const int lastColumn = firstColumn + count - 1;
+    if (count <= 0 || firstColumn < 1 || lastColumn > XLSX_COLUMN_MAX || row < 1)
+        return false;
+
+    return !checkDimensions(row, firstColumn) && !checkDimensions(row, lastColumn);
+}
+
+/*
+  Writes the \a count \a values to the row \a row, from the column
+  \a firstColumn on. The \a format is registered once for the whole
+  row, and numbers, booleans, blanks and plain strings go straight to
+  the cell table. The other values, which need more than a cell
+  record, go through Worksheet::write().
+ */
+bool WorksheetPrivate::writeRowValues(int row, int firstColumn, const QVariant *values, int count, const Format &format)
+{
+    Q_Q(Worksheet);
+    if (!checkRowDimensions(row, firstColumn, count))
+        return false;
+
+    int style = -1;
+    if (format.isValid()) {
+        workbook->styles()->addXfFormat(format);
+        style = styleIndex(format);
+    }
+
+    //Strings which write() would convert, or store inline, aren't plain.
+    const bool plainStrings = workbook->stringStoragePolicy() == Workbook::SharedStringStorage
+            && !workbook->isStringsToNumbersEnabled()
+            && !workbook->isStringsToHyperlinksEnabled()
+            && !workbook->isHtmlToRichStringEnabled();
+
+    bool ret = true;
+    for (int i=0; i<count; ++i) {
+        const int column = firstColumn + i;
+        const QVariant &value = values[i];
+        const int cellStyle = format.isValid() ? style : styleIndex(row, column, StyleId());
+
+        if (value.isNull()) {
+            releaseString(row, column);
+            cellTable.setBlank(row, column, cellStyle);
+            continue;
+        }
+
+        switch (value.userType()) {
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+        case QMetaType::Float:
+            releaseString(row, column);
+            cellTable.setNumber(row, column, value.toDouble(), cellStyle);
+            continue;
+        case QMetaType::Bool:
+            releaseString(row, column);
+            cellTable.setBoolean(row, column, value.toBool(), cellStyle);
+            continue;
+        case QMetaType::QString: {
+            const QString text = value.toString();
+            if (plainStrings && !text.startsWith(QLatin1Char('='))) {
+                int sst_idx = sharedStrings()->addSharedString(text);
+                releaseString(row, column);
+                cellTable.setString(row, column, sst_idx, cellStyle);
+                continue;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (!q->write(row, column, value, format))
+            ret = false;
+    }
+    streamRows(row);
+    return ret;
+}
+
+/*!
+ * Write the \a values to the row \a row, from the cell (\a row,
+ * \a firstColumn) on, with the \a format. The values are converted
+ * the same way write() does.
+ *
+ * This is faster than writing the cells one by one: the dimensions
+ * are checked and the \a format is looked up once for the whole row.
+ *
+ * Returns false if any of the cells is out of the sheet, in which
+ * case nothing is written, or if any of the values can't be written.
+ */
+bool Worksheet::writeRow(int row, int firstColumn, const QVector<QVariant> &values, const Format &format)
+{
+    Q_D(Worksheet);
+    return d->writeRowValues(row, firstColumn, values.constData(), values.size(), format);
+}
+
+/*!
+ * \overload
+ *
+ * Write the numbers \a values to the row \a row, from the cell
+ * (\a row, \a firstColumn) on, with the interned \a style. An invalid
+ * \a style keeps the style of each cell.
+ *
+ * \sa Workbook::internStyle()
+ */
+bool Worksheet::writeRow(int row, int firstColumn, const QVector<double> &values, StyleId style)
+{
+    Q_D(Worksheet);
+    if (!d->checkRowDimensions(row, firstColumn, values.size()))
+        return false;
+
+    for (int i=0; i<values.size(); ++i) {
+        const int column = firstColumn + i;
+        d->releaseString(row, column);
+        d->cellTable.setNumber(row, column, values[i], d->styleIndex(row, column, style));
+    }
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+ * \overload
+ *
+ * Write the strings \a values to the row \a row, from the cell
+ * (\a row, \a firstColumn) on, with the interned \a style. The
+ * strings are always written as plain shared strings. An invalid
+ * \a style keeps the style of each cell.
+ *
+ * \sa Workbook::internStyle()
+ */
+bool Worksheet::writeRow(int row, int firstColumn, const QStringList &values, StyleId style)
+{
+    Q_D(Worksheet);
+    if (!d->checkRowDimensions(row, firstColumn, values.size()))
+        return false;
+
+    for (int i=0; i<values.size(); ++i) {
+        const int column = firstColumn + i;
+        int sst_idx = d->sharedStrings()->addSharedString(values[i]);
+        d->releaseString(row, column);
+        d->cellTable.setString(row, column, sst_idx, d->styleIndex(row, column, style));
+    }
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+ * Write the rows of \a values from the cell \a topLeft on, with the
+ * \a format. Each row is written with writeRow().
+ *
+ * Returns false if any of the rows can't be written.
+ */
+bool Worksheet::writeRange(const CellReference &topLeft, const QVector<QVector<QVariant> > &values, const Format &format)
+{
+    Q_D(Worksheet);
+    if (!topLeft.isValid())
+        return false;
+
+    bool ret = true;
+    for (int i=0; i<values.size(); ++i) {
+        if (values[i].isEmpty())
+            continue;
+        if (!d->writeRowValues(topLeft.row() + i, topLeft.column(), values[i].constData(), values[i].size(), format))
+            ret = false;
+    }
+    return ret;
+}
+
 /*!
     \overload
     Return the contents of the cell \a row_column.
@@ -518,24 +882,52 @@ QVariant Worksheet::read(int row, int column) const
 {
     Q_D(const Worksheet);
 
+    //Cells other than Cell objects are read without creating one.
+    const CellTable::CellKind kind = d->cellTable.kind(row, column);
+    switch (kind) {
+    case CellTable::NoCell:
+        return QVariant();
+    case CellTable::BooleanCell:
+        return d->cellTable.number(row, column) != 0;
+    case CellTable::StringCell:
+        return d->sharedStrings()->getSharedPlainString(d->cellTable.stringIndex(row, column));
+    case CellTable::InlineStringCell:
+        return d->cellTable.inlineString(row, column).toPlainString();
+    case CellTable::FormulaCell: {
+        QVariant text = d->formulaText(row, column, d->cellTable.formula(row, column));
+        if (text.isValid())
+            return text;
+    }
+        //fall through
+    case CellTable::NumberCell:
+    case CellTable::BlankCell: {
+        //Same as Cell::isDateTime(), which treats blank cells as 0.
+        const double val = d->cellTable.number(row, column);
+        const int style = d->cellTable.style(row, column);
+        if (val >= 0 && style >= 0 && d->workbook->styles()->xfFormat(style).isDateTimeFormat()) {
+            QDateTime dt = datetimeFromNumber(val, d->workbook->isDate1904());
+            if (val < 1)
+                return dt.time();
+            if (fmod(val, 1.0) <  1.0/(1000*60*60*24)) //integer
+                return dt.date();
+            return dt;
+        }
+        if (kind == CellTable::BlankCell)
+            return QVariant();
+        return val;
+    }
+    default:
+        break;
+    }
+
     Cell *cell = cellAt(row, column);
     if (!cell)
         return QVariant();
 
     if (cell->hasFormula()) {
-        if (cell->formula().formulaType() == CellFormula::NormalType) {
-            return QVariant(QLatin1String("=")+cell->formula().formulaText());
-        } else if (cell->formula().formulaType() == CellFormula::SharedType) {
-            if (!cell->formula().formulaText().isEmpty()) {
-                return QVariant(QLatin1String("=")+cell->formula().formulaText());
-            } else {
-                const CellFormula &rootFormula = d->sharedFormulaMap[cell->formula().sharedIndex()];
-                CellReference rootCellRef = rootFormula.reference().topLeft();
-                QString rootFormulaText = rootFormula.formulaText();
-                QString newFormulaText = convertSharedFormula(rootFormulaText, rootCellRef, CellReference(row, column));
-                return QVariant(QLatin1String("=")+newFormulaText);
-            }
-        }
+        QVariant text = d->formulaText(row, column, cell->formula());
+        if (text.isValid())
+            return text;
     }
 
     if (cell->isDateTime()) {
@@ -551,6 +943,28 @@ QVariant Worksheet::read(int row, int column) const
     return cell->value();
 }
 
+/*
+  Returns the text of the \a formula of the cell (\a row, \a col)
+  as read() returns it, or an invalid QVariant for array formulas.
+ */
+QVariant WorksheetPrivate::formulaText(int row, int col, const CellFormula &formula) const
+{
+    if (formula.formulaType() == CellFormula::NormalType) {
+        return QVariant(QLatin1String("=")+formula.formulaText());
+    } else if (formula.formulaType() == CellFormula::SharedType) {
+        if (!formula.formulaText().isEmpty()) {
+            return QVariant(QLatin1String("=")+formula.formulaText());
+        } else {
+            const CellFormula rootFormula = sharedFormulaMap.value(formula.sharedIndex());
+            CellReference rootCellRef = rootFormula.reference().topLeft();
+            QString rootFormulaText = rootFormula.formulaText();
+            QString newFormulaText = convertSharedFormula(rootFormulaText, rootCellRef, CellReference(row, col));
+            return QVariant(QLatin1String("=")+newFormulaText);
+        }
+    }
+    return QVariant();
+}
+
 /*!
  * Returns the cell at the given \a row_column. If there
  * is no cell at the specified position, the function returns 0.
@@ -570,21 +984,84 @@ Cell *Worksheet::cellAt(const CellReference &row_column) const
 Cell *Worksheet::cellAt(int row, int column) const
 {
     Q_D(const Worksheet);
-    if (!d->cellTable.contains(row))
-        return 0;
-    if (!d->cellTable[row].contains(column))
-        return 0;
+    return d->cellObject(row, column).data();
+}
 
-    return d->cellTable[row][column].data();
+/*
+  Returns the cell at (\a row, \a col) as a Cell object. A typed cell
+  is converted into one, so that the pointer stays valid until the
+  cell is written again.
+ */
+QSharedPointer<Cell> WorksheetPrivate::cellObject(int row, int col) const
+{
+    Q_Q(const Worksheet);
+    const CellTable::CellKind kind = cellTable.kind(row, col);
+    if (kind == CellTable::NoCell)
+        return QSharedPointer<Cell>();
+    if (kind == CellTable::ObjectCell)
+        return cellTable.cell(row, col);
+
+    Worksheet *sheet = const_cast<Worksheet *>(q);
+    Format format = cellFormat(row, col);
+    QSharedPointer<Cell> cell;
+    if (kind == CellTable::NumberCell) {
+        cell = QSharedPointer<Cell>(new Cell(cellTable.number(row, col), Cell::NumberType, format, sheet));
+    } else if (kind == CellTable::BooleanCell) {
+        cell = QSharedPointer<Cell>(new Cell(cellTable.number(row, col) != 0, Cell::BooleanType, format, sheet));
+    } else if (kind == CellTable::StringCell) {
+        const int sst_idx = cellTable.stringIndex(row, col);
+        RichString rs = sharedStrings()->getSharedString(sst_idx);
+        cell = QSharedPointer<Cell>(new Cell(rs.toPlainString(), Cell::SharedStringType, format, sheet));
+        cell->d_ptr->richString = rs;
+        cell->d_ptr->sharedStringIndex = sst_idx;
+    } else if (kind == CellTable::InlineStringCell) {
+        RichString rs = cellTable.inlineString(row, col);
+        cell = QSharedPointer<Cell>(new Cell(rs.toPlainString(), Cell::InlineStringType, format, sheet));
+        if (rs.isRichString())
+            cell->d_ptr->richString = rs;
+    } else if (kind == CellTable::FormulaCell) {
+        cell = QSharedPointer<Cell>(new Cell(cellTable.number(row, col), Cell::NumberType, format, sheet));
+        cell->d_ptr->formula = cellTable.formula(row, col);
+    } else {
+        //Note: NumberType with an invalid QVariant value means blank.
+        cell = QSharedPointer<Cell>(new Cell(QVariant(), Cell::NumberType, format, sheet));
+    }
+    cellTable.setCell(row, col, cell);
+    return cell;
 }
 
 Format WorksheetPrivate::cellFormat(int row, int col) const
 {
-    if (!cellTable.contains(row))
+    const CellTable::CellKind kind = cellTable.kind(row, col);
+    if (kind == CellTable::NoCell)
         return Format();
-    if (!cellTable[row].contains(col))
-        return Format();
-    return cellTable[row][col]->format();
+    if (kind == CellTable::ObjectCell)
+        return cellTable.cell(row, col)->format();
+
+    const int style = cellTable.style(row, col);
+    return style >= 0 ? workbook->styles()->xfFormat(style) : Format();
+}
+
+/*
+  Returns the xf index the cell table keeps for the \a format, which
+  has been added to the styles already. Empty formats have no index.
+ */
+int WorksheetPrivate::styleIndex(const Format &format) const
+{
+    return format.isEmpty() ? -1 : format.xfIndex();
+}
+
+/*
+  Returns the xf index of the interned \a style, or the one of the
+  cell (\a row, \a col) if the \a style is invalid.
+ */
+int WorksheetPrivate::styleIndex(int row, int col, StyleId style) const
+{
+    if (style.isValid())
+        return style.xfIndex();
+    if (cellTable.kind(row, col) == CellTable::ObjectCell)
+        return styleIndex(cellTable.cell(row, col)->format());
+    return cellTable.style(row, col);
 }
 
 /*!
@@ -617,14 +1094,14 @@ bool Worksheet::writeString(int row, int column, const RichString &value, const
 //        error = -2;
 //    }
 
-    d->sharedStrings()->addSharedString(value);
+    int sst_idx = d->sharedStrings()->addSharedString(value);
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     if (value.fragmentCount() == 1 && value.fragmentFormat(0).isValid())
         fmt.mergeFormat(value.fragmentFormat(0));
     d->workbook->styles()->addXfFormat(fmt);
-    QSharedPointer<Cell> cell = QSharedPointer<Cell>(new Cell(value.toPlainString(), Cell::SharedStringType, fmt, this));
-    cell->d_ptr->richString = value;
-    d->cellTable[row][column] = cell;
+    d->releaseString(row, column);
+    d->cellTable.setString(row, column, sst_idx, d->styleIndex(fmt));
+    d->streamRows(row);
     return true;
 }
 
@@ -652,13 +1129,108 @@ bool Worksheet::writeString(int row, int column, const QString &value, const For
     if (d->checkDimensions(row, column))
         return false;
 
-    RichString rs;
-    if (d->workbook->isHtmlToRichStringEnabled() && Qt::mightBeRichText(value))
+    if (d->workbook->isHtmlToRichStringEnabled() && Qt::mightBeRichText(value)) {
+        RichString rs;
         rs.setHtml(value);
-    else
-        rs.addFragment(value, Format());
+        return writeString(row, column, rs, format);
+    }
+
+    //Plain text goes to the shared strings without a RichString.
+    int sst_idx = d->sharedStrings()->addSharedString(value);
+    Format fmt = format.isValid() ? format : d->cellFormat(row, column);
+    d->workbook->styles()->addXfFormat(fmt);
+    d->releaseString(row, column);
+    d->cellTable.setString(row, column, sst_idx, d->styleIndex(fmt));
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+    \overload
+
+    Write string \a value to the cell (\a row, \a column) with the
+    interned \a style. The \a value is always written as plain text.
+    An invalid \a style keeps the style of the cell.
+    Returns true on success.
 
-    return writeString(row, column, rs, format);
+    \sa Workbook::internStyle()
+*/
+bool Worksheet::writeString(int row, int column, const QString &value, StyleId style)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    int sst_idx = d->sharedStrings()->addSharedString(value);
+    d->releaseString(row, column);
+    d->cellTable.setString(row, column, sst_idx, d->styleIndex(row, column, style));
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+    \overload
+
+    Write the interned \a string to the cell (\a row, \a column) with
+    the \a format. Returns true on success, or false if \a string is
+    invalid.
+
+    \sa internString()
+*/
+bool Worksheet::writeString(int row, int column, StringId string, const Format &format)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    int sst_idx = d->sharedStrings()->addSharedString(string);
+    if (sst_idx < 0)
+        return false;
+
+    Format fmt = format.isValid() ? format : d->cellFormat(row, column);
+    d->workbook->styles()->addXfFormat(fmt);
+    d->releaseString(row, column);
+    d->cellTable.setString(row, column, sst_idx, d->styleIndex(fmt));
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+    \overload
+
+    Write the interned \a string to the cell (\a row, \a column) with
+    the interned \a style. An invalid \a style keeps the style of the
+    cell. Returns true on success, or false if \a string is invalid.
+
+    \sa internString(), Workbook::internStyle()
+*/
+bool Worksheet::writeString(int row, int column, StringId string, StyleId style)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    int sst_idx = d->sharedStrings()->addSharedString(string);
+    if (sst_idx < 0)
+        return false;
+
+    d->releaseString(row, column);
+    d->cellTable.setString(row, column, sst_idx, d->styleIndex(row, column, style));
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+    Registers the plain text \a string with the workbook of the sheet
+    and returns its handle, which can be written to any sheet of the
+    workbook.
+
+    \sa Workbook::internString()
+*/
+StringId Worksheet::internString(const QString &string)
+{
+    Q_D(Worksheet);
+    return d->workbook->internString(string);
 }
 
 /*!
@@ -692,7 +1264,9 @@ bool Worksheet::writeInlineString(int row, int column, const QString &value, con
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::InlineStringType, fmt, this));
+    d->releaseString(row, column);
+    d->cellTable.setInlineString(row, column, RichString(value), d->styleIndex(fmt));
+    d->streamRows(row);
     return true;
 }
 
@@ -721,7 +1295,62 @@ bool Worksheet::writeNumeric(int row, int column, double value, const Format &fo
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::NumberType, fmt, this));
+    d->releaseString(row, column);
+    d->cellTable.setNumber(row, column, value, d->styleIndex(fmt));
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+    \overload
+
+    Write numeric \a value to the cell (\a row, \a column) with the
+    interned \a style. An invalid \a style keeps the style of the cell.
+    Returns true on success.
+
+    \sa Workbook::internStyle()
+*/
+bool Worksheet::writeNumeric(int row, int column, double value, StyleId style)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    d->releaseString(row, column);
+    d->cellTable.setNumber(row, column, value, d->styleIndex(row, column, style));
+    d->streamRows(row);
+    return true;
+}
+
+/*!
+    Write the \a count numbers at \a values to the column \a column,
+    from the cell (\a firstRow, \a column) on, with the interned
+    \a style. An invalid \a style keeps the style of each cell.
+
+    The dimensions are checked once for the whole column. Returns false
+    if any of the cells is out of the sheet, in which case nothing is
+    written.
+
+    \sa Workbook::internStyle()
+*/
+bool Worksheet::writeNumericColumn(int firstRow, int column, const double *values, int count, StyleId style)
+{
+    Q_D(Worksheet);
+    const int lastRow = firstRow + count - 1;
+    if (count <= 0 || firstRow < 1 || lastRow > XLSX_ROW_MAX || column < 1 || column > XLSX_COLUMN_MAX)
+        return false;
+    if (d->checkDimensions(firstRow, column) || d->checkDimensions(lastRow, column))
+        return false;
+
+    for (int i=0; i<count; ++i) {
+        const int row = firstRow + i;
+        d->releaseString(row, column);
+        d->cellTable.setNumber(row, column, values[i], d->styleIndex(row, column, style));
+        //Let the streaming mode release each block once it is complete.
+        if (row % CellTable::BlockRows == 0)
+            d->streamRows(row);
+    }
+    d->streamRows(lastRow);
     return true;
 }
 
@@ -751,20 +1380,46 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
 
+    d->writeFormula(row, column, formula_, d->styleIndex(fmt), result);
+    return true;
+}
+
+/*!
+    \overload
+
+    Write \a formula to the cell (\a row, \a column) with the interned
+    \a style and \a result. An invalid \a style keeps the style of the cell.
+    Returns true on success.
+
+    \sa Workbook::internStyle()
+*/
+bool Worksheet::writeFormula(int row, int column, const CellFormula &formula, StyleId style, double result)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    d->writeFormula(row, column, formula, d->styleIndex(row, column, style), result);
+    return true;
+}
+
+void WorksheetPrivate::writeFormula(int row, int column, const CellFormula &formula_, int style, double result)
+{
+    Q_Q(Worksheet);
+
     CellFormula formula = formula_;
     formula.d->ca = true;
     if (formula.formulaType() == CellFormula::SharedType) {
         //Assign proper shared index for shared formula
         int si=0;
-        while(d->sharedFormulaMap.contains(si))
+        while(sharedFormulaMap.contains(si))
             ++si;
         formula.d->si = si;
-        d->sharedFormulaMap[si] = formula;
+        sharedFormulaMap[si] = formula;
     }
 
-    QSharedPointer<Cell> data = QSharedPointer<Cell>(new Cell(result, Cell::NumberType, fmt, this));
-    data->d_ptr->formula = formula;
-    d->cellTable[row][column] = data;
+    releaseString(row, column);
+    cellTable.setFormula(row, column, formula, result, style);
 
     CellRange range = formula.reference();
     if (formula.formulaType() == CellFormula::SharedType) {
@@ -772,22 +1427,21 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
         sf.d->si = formula.sharedIndex();
         for (int r=range.firstRow(); r<=range.lastRow(); ++r) {
             for (int c=range.firstColumn(); c<=range.lastColumn(); ++c) {
-                if (!(r==row && c==column)) {
-                    if(Cell *cell = cellAt(r, c)) {
+                if (!(r==row && c==column) && r > streamedRow) {
+                    const CellTable::CellKind kind = cellTable.kind(r, c);
+                    if (kind == CellTable::NoCell) {
+                        cellTable.setFormula(r, c, sf, result, style);
+                    } else if (kind == CellTable::NumberCell || kind == CellTable::FormulaCell) {
+                        cellTable.setFormula(r, c, sf, cellTable.number(r, c), cellTable.style(r, c));
+                    } else if (Cell *cell = q->cellAt(r, c)) {
                         cell->d_ptr->formula = sf;
-                    } else {
-                        QSharedPointer<Cell> newCell = QSharedPointer<Cell>(new Cell(result, Cell::NumberType, fmt, this));
-                        newCell->d_ptr->formula = sf;
-                        d->cellTable[r][c] = newCell;
                     }
                 }
             }
         }
-    } else if (formula.formulaType() == CellFormula::SharedType) {
-
     }
 
-    return true;
+    streamRows(row);
 }
 
 /*!
@@ -816,8 +1470,29 @@ bool Worksheet::writeBlank(int row, int column, const Format &format)
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
 
-    //Note: NumberType with an invalid QVariant value means blank.
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(QVariant(), Cell::NumberType, fmt, this));
+    d->releaseString(row, column);
+    d->cellTable.setBlank(row, column, d->styleIndex(fmt));
+    d->streamRows(row);
+
+    return true;
+}
+
+/*!
+    \overload
+
+    Write a empty cell (\a row, \a column) with the interned \a style.
+    An invalid \a style keeps the style of the cell.
+    Returns true on success.
+ */
+bool Worksheet::writeBlank(int row, int column, StyleId style)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    d->releaseString(row, column);
+    d->cellTable.setBlank(row, column, d->styleIndex(row, column, style));
+    d->streamRows(row);
 
     return true;
 }
@@ -846,7 +1521,29 @@ bool Worksheet::writeBool(int row, int column, bool value, const Format &format)
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::BooleanType, fmt, this));
+    d->releaseString(row, column);
+    d->cellTable.setBoolean(row, column, value, d->styleIndex(fmt));
+    d->streamRows(row);
+
+    return true;
+}
+
+/*!
+    \overload
+
+    Write a bool \a value to the cell (\a row, \a column) with the
+    interned \a style. An invalid \a style keeps the style of the cell.
+    Returns true on success.
+ */
+bool Worksheet::writeBool(int row, int column, bool value, StyleId style)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    d->releaseString(row, column);
+    d->cellTable.setBoolean(row, column, value, d->styleIndex(row, column, style));
+    d->streamRows(row);
 
     return true;
 }
@@ -880,11 +1577,73 @@ bool Worksheet::writeDateTime(int row, int column, const QDateTime &dt, const Fo
 
     double value = datetimeToNumber(dt, d->workbook->isDate1904());
 
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::NumberType, fmt, this));
+    d->releaseString(row, column);
+    d->cellTable.setNumber(row, column, value, d->styleIndex(fmt));
+    d->streamRows(row);
+
+    return true;
+}
+
+/*!
+    \overload
+
+    Write a QDateTime \a dt to the cell (\a row, \a column) with the
+    interned \a style, which should have a date time number format.
+    Unlike the overload taking a Format, no default date format is
+    applied. An invalid \a style keeps the style of the cell.
+    Returns true on success.
+ */
+bool Worksheet::writeDateTime(int row, int column, const QDateTime &dt, StyleId style)
+{
+    Q_D(Worksheet);
+    if (d->checkDimensions(row, column))
+        return false;
+
+    double value = datetimeToNumber(dt, d->workbook->isDate1904());
+
+    d->releaseString(row, column);
+    d->cellTable.setNumber(row, column, value, d->styleIndex(row, column, style));
+    d->streamRows(row);
 
     return true;
 }
 
+/*!
+    Write the \a count date times at \a values to the column \a column,
+    from the cell (\a firstRow, \a column) on, with the interned
+    \a style. If \a style is invalid, the default date format of the
+    workbook is used.
+
+    The date times are converted all at once, which is faster than
+    writing them one by one. The cells hold the local date and time of
+    the \a values as read on a wall clock, which may differ by one hour
+    from write() around daylight saving time changes. Returns false if
+    any of the cells is out of the sheet or any of the \a values is
+    invalid, in which case nothing is written.
+
+    \sa writeNumericColumn(), Workbook::defaultDateFormat()
+*/
+bool Worksheet::writeDateTimeColumn(int firstRow, int column, const QDateTime *values, int count, StyleId style)
+{
+    Q_D(Worksheet);
+    if (count <= 0)
+        return false;
+    for (int i=0; i<count; ++i) {
+        if (!values[i].isValid())
+            return false;
+    }
+
+    QVector<double> numbers(count);
+    datetimesToNumbers(values, numbers.data(), count, d->workbook->isDate1904());
+
+    if (!style.isValid()) {
+        Format format;
+        format.setNumberFormat(d->workbook->defaultDateFormat());
+        style = d->workbook->internStyle(format);
+    }
+    return writeNumericColumn(firstRow, column, numbers.constData(), count, style);
+}
+
 /*!
     \overload
     Write a QTime \a t to the cell \a row_column with the \a format.
@@ -913,7 +1672,9 @@ bool Worksheet::writeTime(int row, int column, const QTime &t, const Format &for
         fmt.setNumberFormat(QStringLiteral("hh:mm:ss"));
     d->workbook->styles()->addXfFormat(fmt);
 
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(timeToNumber(t), Cell::NumberType, fmt, this));
+    d->releaseString(row, column);
+    d->cellTable.setNumber(row, column, timeToNumber(t), d->styleIndex(fmt));
+    d->streamRows(row);
 
     return true;
 }
@@ -977,11 +1738,13 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
     d->workbook->styles()->addXfFormat(fmt);
 
     //Write the hyperlink string as normal string.
-    d->sharedStrings()->addSharedString(displayString);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(displayString, Cell::SharedStringType, fmt, this));
+    int sst_idx = d->sharedStrings()->addSharedString(displayString);
+    d->releaseString(row, column);
+    d->cellTable.setString(row, column, sst_idx, d->styleIndex(fmt));
 
     //Store the hyperlink data in a separate table
     d->urlTable[row][column] = QSharedPointer<XlsxHyperlinkData>(new XlsxHyperlinkData(XlsxHyperlinkData::External, urlString, locationString, QString(), tip));
+    d->streamRows(row);
 
     return true;
 }
@@ -1234,8 +1997,21 @@ void Worksheet::saveToXmlFile(QIODevice *device) const
     }
 
     writer.writeStartElement(QStringLiteral("sheetData"));
+    if (d->streamFile || d->dimension.isValid()) {
+        //Close the start tag, the rows are written to the device directly.
+        writer.writeCharacters(QString());
+    }
+    if (d->streamFile) {
+        //Splice in the rows streamed out already.
+        d->streamFile->flush();
+        qint64 pos = d->streamFile->pos();
+        d->streamFile->seek(0);
+        while (!d->streamFile->atEnd())
+            device->write(d->streamFile->read(64 * 1024));
+        d->streamFile->seek(pos);
+    }
     if (d->dimension.isValid())
-        d->saveXmlSheetData(writer);
+        d->saveXmlSheetData(device, qMax(d->streamedRow + 1, d->dimension.firstRow()), d->dimension.lastRow());
     writer.writeEndElement();//sheetData
 
     d->saveXmlMergeCells(writer);
@@ -1250,132 +2026,291 @@ void Worksheet::saveToXmlFile(QIODevice *device) const
     writer.writeEndDocument();
 }
 
-void WorksheetPrivate::saveXmlSheetData(QXmlStreamWriter &writer) const
-{
-    calculateSpans();
-    for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        if (!(cellTable.contains(row_num) || comments.contains(row_num) || rowsInfo.contains(row_num))) {
-            //Only process rows with cell data / comments / formatting
-            continue;
+void WorksheetPrivate::saveXmlSheetData(QIODevice *device, int firstRow, int lastRow) const
+{
+    SheetDataWriter writer(device);
+
+    calculateSpans(firstRow, lastRow);
+
+    //Only the rows with cell data / comments / formatting are written.
+    //They are taken in order from the cell table and the two maps.
+    QMap<int, QMap<int, QString> >::const_iterator commentIt = comments.lowerBound(firstRow);
+    QMap<int, QSharedPointer<XlsxRowInfo> >::const_iterator rowInfoIt = rowsInfo.lowerBound(firstRow);
+    int cellRow = cellTable.nextRow(firstRow - 1);
+    for (;;) {
+        int row_num = cellRow == -1 ? lastRow + 1 : cellRow;
+        if (commentIt != comments.constEnd() && commentIt.key() < row_num)
+            row_num = commentIt.key();
+        if (rowInfoIt != rowsInfo.constEnd() && rowInfoIt.key() < row_num)
+            row_num = rowInfoIt.key();
+        if (row_num > lastRow)
+            break;
+
+        const bool hasCells = row_num == cellRow;
+        if (hasCells)
+            cellRow = cellTable.nextRow(row_num);
+        if (commentIt != comments.constEnd() && commentIt.key() == row_num)
+            ++commentIt;
+        const XlsxRowInfo *rowInfo = 0;
+        if (rowInfoIt != rowsInfo.constEnd() && rowInfoIt.key() == row_num) {
+            rowInfo = rowInfoIt->data();
+            ++rowInfoIt;
         }
 
-        int span_index = (row_num-1) / 16;
-        QString span;
-        if (row_spans.contains(span_index))
-            span = row_spans[span_index];
+        //Style of the cells of the row which have none of their own.
+        const int rowXfIndex = rowInfo && !rowInfo->format.isEmpty() ? rowInfo->format.xfIndex() : -1;
 
-        writer.writeStartElement(QStringLiteral("row"));
-        writer.writeAttribute(QStringLiteral("r"), QString::number(row_num));
+        writer.writeRaw("<row r=\"");
+        writer.writeNumber(row_num);
+        writer.writeRaw("\"");
 
-        if (!span.isEmpty())
-            writer.writeAttribute(QStringLiteral("spans"), span);
+        QMap<int, QPair<int, int> >::const_iterator span = row_spans.constFind((row_num-1) / CellTable::BlockRows);
+        if (span != row_spans.constEnd()) {
+            writer.writeRaw(" spans=\"");
+            writer.writeNumber(span->first);
+            writer.writeRaw(":");
+            writer.writeNumber(span->second);
+            writer.writeRaw("\"");
+        }
 
-        if (rowsInfo.contains(row_num)) {
-            QSharedPointer<XlsxRowInfo> rowInfo = rowsInfo[row_num];
-            if (!rowInfo->format.isEmpty()) {
-                writer.writeAttribute(QStringLiteral("s"), QString::number(rowInfo->format.xfIndex()));
-                writer.writeAttribute(QStringLiteral("customFormat"), QStringLiteral("1"));
+        if (rowInfo) {
+            if (rowXfIndex != -1) {
+                writer.writeRaw(" s=\"");
+                writer.writeNumber(rowXfIndex);
+                writer.writeRaw("\" customFormat=\"1\"");
             }
             //!Todo: support customHeight from info struct
             //!Todo: where does this magic number '15' come from?
             if (rowInfo->customHeight) {
-                writer.writeAttribute(QStringLiteral("ht"), QString::number(rowInfo->height));
-                writer.writeAttribute(QStringLiteral("customHeight"), QStringLiteral("1"));
+                writer.writeRaw(" ht=\"");
+                writer.writeAttributeValue(QString::number(rowInfo->height));
+                writer.writeRaw("\" customHeight=\"1\"");
             } else {
-                writer.writeAttribute(QStringLiteral("customHeight"), QStringLiteral("0"));
+                writer.writeRaw(" customHeight=\"0\"");
             }
 
             if (rowInfo->hidden)
-                writer.writeAttribute(QStringLiteral("hidden"), QStringLiteral("1"));
-            if (rowInfo->outlineLevel > 0)
-                writer.writeAttribute(QStringLiteral("outlineLevel"), QString::number(rowInfo->outlineLevel));
+                writer.writeRaw(" hidden=\"1\"");
+            if (rowInfo->outlineLevel > 0) {
+                writer.writeRaw(" outlineLevel=\"");
+                writer.writeNumber(rowInfo->outlineLevel);
+                writer.writeRaw("\"");
+            }
             if (rowInfo->collapsed)
-                writer.writeAttribute(QStringLiteral("collapsed"), QStringLiteral("1"));
+                writer.writeRaw(" collapsed=\"1\"");
         }
 
         //Write cell data if row contains filled cells
-        if (cellTable.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn(); col_num++) {
-                if (cellTable[row_num].contains(col_num)) {
-                    saveXmlCellData(writer, row_num, col_num, cellTable[row_num][col_num]);
-                }
+        if (!hasCells) {
+            writer.writeRaw("/>");
+            continue;
+        }
+        writer.writeRaw(">");
+
+        //The columns of a block are sorted, so the cells come out in order.
+        const CellTable::Block *block = cellTable.block((row_num-1) / CellTable::BlockRows);
+        const int r = (row_num-1) % CellTable::BlockRows;
+        for (int i=0; i<block->columns.size(); ++i) {
+            const CellTable::Column &column = block->columns[i];
+            if (!(column.rows & (1 << r)))
+                continue;
+
+            const CellTable::CellRecord &rec = column.at(r);
+            switch (rec.kind) {
+            case CellTable::NumberCell:
+                saveXmlCellStart(writer, row_num, column.column, rec.style, rowXfIndex);
+                writer.writeRaw("><v>");
+                writer.writeDouble(rec.number);
+                writer.writeRaw("</v></c>");
+                break;
+            case CellTable::BooleanCell:
+                saveXmlCellStart(writer, row_num, column.column, rec.style, rowXfIndex);
+                writer.writeRaw(rec.number != 0 ? " t=\"b\"><v>1</v></c>" : " t=\"b\"><v>0</v></c>");
+                break;
+            case CellTable::StringCell:
+                saveXmlCellStart(writer, row_num, column.column, rec.style, rowXfIndex);
+                writer.writeRaw(" t=\"s\"><v>");
+                writer.writeNumber(rec.index);
+                writer.writeRaw("</v></c>");
+                break;
+            case CellTable::BlankCell:
+                saveXmlCellStart(writer, row_num, column.column, rec.style, rowXfIndex);
+                writer.writeRaw("/>");
+                break;
+            case CellTable::FormulaCell:
+                saveXmlCellStart(writer, row_num, column.column, rec.style, rowXfIndex);
+                writer.writeRaw(">");
+                saveXmlCellFormula(writer, cellTable.formula(row_num, column.column));
+                writer.writeRaw("<v>");
+                writer.writeDouble(rec.number);
+                writer.writeRaw("</v></c>");
+                break;
+            case CellTable::InlineStringCell:
+                saveXmlCellStart(writer, row_num, column.column, rec.style, rowXfIndex);
+                writer.writeRaw(" t=\"inlineStr\">");
+                saveXmlCellInlineString(writer, cellTable.inlineString(row_num, column.column));
+                writer.writeRaw("</c>");
+                break;
+            default:
+                saveXmlCellData(writer, row_num, column.column, *cellTable.cell(row_num, column.column), rowXfIndex);
+                break;
             }
         }
-        writer.writeEndElement(); //row
+        writer.writeRaw("</row>");
     }
 }
 
-void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int col, QSharedPointer<Cell> cell) const
+/*
+  Writes the start tag of the cell, up to its style. An \a xfIndex
+  of -1 means that the cell uses the row style \a rowXfIndex, or
+  else the column style, if any.
+ */
+void WorksheetPrivate::saveXmlCellStart(SheetDataWriter &writer, int row, int col, int xfIndex, int rowXfIndex) const
 {
     //This is the innermost loop so efficiency is important.
-    QString cell_pos = CellReference(row, col).toString();
-
-    writer.writeStartElement(QStringLiteral("c"));
-    writer.writeAttribute(QStringLiteral("r"), cell_pos);
-
-    //Style used by the cell, row or col
-    if (!cell->format().isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number(cell->format().xfIndex()));
-    else if (rowsInfo.contains(row) && !rowsInfo[row]->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number(rowsInfo[row]->format.xfIndex()));
-    else if (colsInfoHelper.contains(col) && !colsInfoHelper[col]->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number(colsInfoHelper[col]->format.xfIndex()));
-
-    if (cell->cellType() == Cell::SharedStringType) {
-        int sst_idx;
-        if (cell->isRichString())
-            sst_idx = sharedStrings()->getSharedStringIndex(cell->d_ptr->richString);
-        else
-            sst_idx = sharedStrings()->getSharedStringIndex(cell->value().toString());
-
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("s"));
-        writer.writeTextElement(QStringLiteral("v"), QString::number(sst_idx));
-    } else if (cell->cellType() == Cell::InlineStringType) {
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("inlineStr"));
-        writer.writeStartElement(QStringLiteral("is"));
-        if (cell->isRichString()) {
-            //Rich text string
-            RichString string = cell->d_ptr->richString;
-            for (int i=0; i<string.fragmentCount(); ++i) {
-                writer.writeStartElement(QStringLiteral("r"));
-                if (string.fragmentFormat(i).hasFontData()) {
-                    writer.writeStartElement(QStringLiteral("rPr"));
-                    //:Todo
-                    writer.writeEndElement();// rPr
-                }
-                writer.writeStartElement(QStringLiteral("t"));
-                if (isSpaceReserveNeeded(string.fragmentText(i)))
-                    writer.writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
-                writer.writeCharacters(string.fragmentText(i));
-                writer.writeEndElement();// t
-                writer.writeEndElement(); // r
-            }
-        } else {
-            writer.writeStartElement(QStringLiteral("t"));
-            QString string = cell->value().toString();
-            if (isSpaceReserveNeeded(string))
-                writer.writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
-            writer.writeCharacters(string);
-            writer.writeEndElement(); // t
+    writer.writeRaw("<c r=\"");
+    writer.writeCellReference(row, col);
+    writer.writeRaw("\"");
+
+    if (xfIndex == -1) {
+        if (rowXfIndex != -1) {
+            xfIndex = rowXfIndex;
+        } else if (!colsInfoHelper.isEmpty()) {
+            QMap<int, QSharedPointer<XlsxColumnInfo> >::const_iterator colInfo = colsInfoHelper.constFind(col);
+            if (colInfo != colsInfoHelper.constEnd() && !(*colInfo)->format.isEmpty())
+                xfIndex = (*colInfo)->format.xfIndex();
+        }
+    }
+    if (xfIndex != -1) {
+        writer.writeRaw(" s=\"");
+        writer.writeNumber(xfIndex);
+        writer.writeRaw("\"");
+    }
+}
+
+void WorksheetPrivate::saveXmlCellData(SheetDataWriter &writer, int row, int col, const Cell &cell, int rowXfIndex) const
+{
+    const CellPrivate *d = cell.d_ptr;
+
+    saveXmlCellStart(writer, row, col, d->format.isEmpty() ? -1 : d->format.xfIndex(), rowXfIndex);
+
+    switch (d->cellType) {
+    case Cell::SharedStringType: {
+        //The index is kept since the cell was written or loaded.
+        int sst_idx = d->sharedStringIndex;
+        if (sst_idx < 0) {
+            if (d->richString.isRichString())
+                sst_idx = sharedStrings()->getSharedStringIndex(d->richString);
+            else
+                sst_idx = sharedStrings()->getSharedStringIndex(d->value.toString());
+        }
+
+        writer.writeRaw(" t=\"s\"><v>");
+        writer.writeNumber(sst_idx);
+        writer.writeRaw("</v></c>");
+        break;
+    }
+    case Cell::InlineStringType:
+        writer.writeRaw(" t=\"inlineStr\">");
+        saveXmlCellInlineString(writer, d->richString.isRichString() ? d->richString : RichString(d->value.toString()));
+        writer.writeRaw("</c>");
+        break;
+    case Cell::NumberType:
+        if (!d->formula.isValid() && !d->value.isValid()) {
+            writer.writeRaw("/>");
+            break;
+        }
+        writer.writeRaw(">");
+        if (d->formula.isValid())
+            saveXmlCellFormula(writer, d->formula);
+        if (d->value.isValid()) {//note that, invalid value means 'v' is blank
+            writer.writeRaw("<v>");
+            writer.writeDouble(d->value.toDouble());
+            writer.writeRaw("</v>");
         }
-        writer.writeEndElement();//is
-    } else if (cell->cellType() == Cell::NumberType){
-        if (cell->hasFormula())
-            cell->formula().saveToXml(writer);
-        if (cell->value().isValid()) {//note that, invalid value means 'v' is blank
-            double value = cell->value().toDouble();
-            writer.writeTextElement(QStringLiteral("v"), QString::number(value, 'g', 15));
+        writer.writeRaw("</c>");
+        break;
+    case Cell::StringType:
+        writer.writeRaw(" t=\"str\">");
+        if (d->formula.isValid())
+            saveXmlCellFormula(writer, d->formula);
+        writer.writeRaw("<v>");
+        writer.writeText(d->value.toString());
+        writer.writeRaw("</v></c>");
+        break;
+    case Cell::BooleanType:
+        writer.writeRaw(" t=\"b\"><v>");
+        writer.writeRaw(d->value.toBool() ? "1" : "0", 1);
+        writer.writeRaw("</v></c>");
+        break;
+    default:
+        writer.writeRaw("/>");
+        break;
+    }
+}
+
+void WorksheetPrivate::saveXmlCellText(SheetDataWriter &writer, const QString &text) const
+{
+    if (isSpaceReserveNeeded(text))
+        writer.writeRaw("<t xml:space=\"preserve\">");
+    else
+        writer.writeRaw("<t>");
+    writer.writeText(text);
+    writer.writeRaw("</t>");
+}
+
+void WorksheetPrivate::saveXmlCellInlineString(SheetDataWriter &writer, const RichString &string) const
+{
+    writer.writeRaw("<is>");
+    if (string.isRichString()) {
+        //Rich text string
+        for (int i=0; i<string.fragmentCount(); ++i) {
+            writer.writeRaw("<r>");
+            if (string.fragmentFormat(i).hasFontData()) {
+                //:Todo
+                writer.writeRaw("<rPr/>");
+            }
+            saveXmlCellText(writer, string.fragmentText(i));
+            writer.writeRaw("</r>");
         }
-    } else if (cell->cellType() == Cell::StringType) {
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("str"));
-        if (cell->hasFormula())
-            cell->formula().saveToXml(writer);
-        writer.writeTextElement(QStringLiteral("v"), cell->value().toString());
-    } else if (cell->cellType() == Cell::BooleanType) {
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("b"));
-        writer.writeTextElement(QStringLiteral("v"), cell->value().toBool() ? QStringLiteral("1") : QStringLiteral("0"));
+    } else {
+        saveXmlCellText(writer, string.toPlainString());
+    }
+    writer.writeRaw("</is>");
+}
+
+/*
+  Same as CellFormula::saveToXml(), which is used everywhere else.
+ */
+void WorksheetPrivate::saveXmlCellFormula(SheetDataWriter &writer, const CellFormula &formula) const
+{
+    const CellFormulaPrivate *f = formula.d.constData();
+
+    writer.writeRaw("<f");
+    if (f->type == CellFormula::ArrayType)
+        writer.writeRaw(" t=\"array\"");
+    else if (f->type == CellFormula::SharedType)
+        writer.writeRaw(" t=\"shared\"");
+    if (f->reference.isValid()) {
+        writer.writeRaw(" ref=\"");
+        writer.writeAttributeValue(f->reference.toString());
+        writer.writeRaw("\"");
+    }
+    if (f->ca)
+        writer.writeRaw(" ca=\"1\"");
+    if (f->type == CellFormula::SharedType) {
+        writer.writeRaw(" si=\"");
+        writer.writeNumber(f->si);
+        writer.writeRaw("\"");
+    }
+
+    if (f->formula.isEmpty()) {
+        writer.writeRaw("/>");
+    } else {
+        writer.writeRaw(">");
+        writer.writeText(f->formula);
+        writer.writeRaw("</f>");
     }
-    writer.writeEndElement(); //c
 }
 
 void WorksheetPrivate::saveXmlMergeCells(QXmlStreamWriter &writer) const
@@ -1933,10 +2868,20 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
     Q_Q(Worksheet);
     Q_ASSERT(reader.name() == QLatin1String("sheetData"));
 
+    //"r" is optional for both rows and cells, which then follow the
+    //previous row, or the previous cell of the row.
+    int currentRow = 0;
+    int currentColumn = 0;
+
     while (!reader.atEnd() && !(reader.name() == QLatin1String("sheetData") && reader.tokenType() == QXmlStreamReader::EndElement)) {
         if (reader.readNextStartElement()) {
             if (reader.name() == QLatin1String("row")) {
                 QXmlStreamAttributes attributes = reader.attributes();
+                if (attributes.hasAttribute(QLatin1String("r")))
+                    currentRow = attributes.value(QLatin1String("r")).toString().toInt();
+                else
+                    ++currentRow;
+                currentColumn = 0;
 
                 if (attributes.hasAttribute(QLatin1String("customFormat"))
                         || attributes.hasAttribute(QLatin1String("customHeight"))
@@ -1965,17 +2910,20 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                     if (attributes.hasAttribute(QLatin1String("outlineLevel")))
                         info->outlineLevel = attributes.value(QLatin1String("outlineLevel")).toString().toInt();
 
-                    //"r" is optional too.
-                    if (attributes.hasAttribute(QLatin1String("r"))) {
-                        int row = attributes.value(QLatin1String("r")).toString().toInt();
-                        rowsInfo[row] = info;
-                    }
+                    if (currentRow >= 1 && currentRow <= XLSX_ROW_MAX)
+                        rowsInfo[currentRow] = info;
                 }
 
             } else if (reader.name() == QLatin1String("c")) {  //Cell
                 QXmlStreamAttributes attributes = reader.attributes();
-                QString r = attributes.value(QLatin1String("r")).toString();
-                CellReference pos(r);
+                const QStringRef r = attributes.value(QLatin1String("r"));
+                int row = currentRow, col = currentColumn + 1;
+                if (!r.isEmpty() && !parseCellReference(reinterpret_cast<const ushort *>(r.unicode()), r.size(), &row, &col))
+                    row = col = -1;
+                currentColumn = col;
+                const CellReference pos(row, col);
+                //Cells out of the sheet are read, but dropped.
+                const bool valid = row >= 1 && row <= XLSX_ROW_MAX && col >= 1 && col <= XLSX_COLUMN_MAX;
 
                 //get format
                 Format format;
@@ -2004,37 +2952,35 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         cellType = Cell::NumberType;
                 }
 
-                QSharedPointer<Cell> cell(new Cell(QVariant() ,cellType, format, q));
+                QVariant value;
+                CellFormula formula;
+                int sst_idx = -1;
                 while (!reader.atEnd() && !(reader.name() == QLatin1String("c") && reader.tokenType() == QXmlStreamReader::EndElement)) {
                     if (reader.readNextStartElement()) {
                         if (reader.name() == QLatin1String("f")) {
-                            CellFormula &formula = cell->d_func()->formula;
                             formula.loadFromXml(reader);
                             if (formula.formulaType() == CellFormula::SharedType && !formula.formulaText().isEmpty()) {
                                 sharedFormulaMap[formula.sharedIndex()] = formula;
                             }
                         } else if (reader.name() == QLatin1String("v")) {
-                            QString value = reader.readElementText();
+                            QString text = reader.readElementText();
                             if (cellType == Cell::SharedStringType) {
-                                int sst_idx = value.toInt();
-                                sharedStrings()->incRefByStringIndex(sst_idx);
-                                RichString rs = sharedStrings()->getSharedString(sst_idx);
-                                cell->d_func()->value = rs.toPlainString();
-                                if (rs.isRichString())
-                                    cell->d_func()->richString = rs;
+                                sst_idx = text.toInt();
+                                if (valid)
+                                    sharedStrings()->incRefByStringIndex(sst_idx);
                             } else if (cellType == Cell::NumberType) {
-                                cell->d_func()->value = value.toDouble();
+                                value = text.toDouble();
                             } else if (cellType == Cell::BooleanType) {
-                                cell->d_func()->value = value.toInt() ? true : false;
+                                value = text.toInt() ? true : false;
                             } else { //Cell::ErrorType and Cell::StringType
-                                cell->d_func()->value = value;
+                                value = text;
                             }
                         } else if (reader.name() == QLatin1String("is")) {
                             while (!reader.atEnd() && !(reader.name() == QLatin1String("is") && reader.tokenType() == QXmlStreamReader::EndElement)) {
                                 if (reader.readNextStartElement()) {
                                     //:Todo, add rich text read support
                                     if (reader.name() == QLatin1String("t")) {
-                                        cell->d_func()->value = reader.readElementText();
+                                        value = reader.readElementText();
                                     }
                                 }
                             }
@@ -2047,7 +2993,45 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         }
                     }
                 }
-                cellTable[pos.row()][pos.column()] = cell;
+
+                if (!valid)
+                    continue;
+
+                const bool validString = sst_idx >= 0 && sst_idx < sharedStrings()->uniqueCount();
+                if (formula.isValid()) {
+                    if (cellType == Cell::NumberType && value.isValid()) {
+                        cellTable.setFormula(pos.row(), pos.column(), formula, value.toDouble(), styleIndex(format));
+                        continue;
+                    }
+                } else if (cellType == Cell::InlineStringType) {
+                    cellTable.setInlineString(pos.row(), pos.column(), RichString(value.toString()), styleIndex(format));
+                    continue;
+                } else if (cellType == Cell::NumberType && value.isValid()) {
+                    cellTable.setNumber(pos.row(), pos.column(), value.toDouble(), styleIndex(format));
+                    continue;
+                } else if (cellType == Cell::NumberType) {
+                    cellTable.setBlank(pos.row(), pos.column(), styleIndex(format));
+                    continue;
+                } else if (cellType == Cell::BooleanType && value.isValid()) {
+                    cellTable.setBoolean(pos.row(), pos.column(), value.toBool(), styleIndex(format));
+                    continue;
+                } else if (cellType == Cell::SharedStringType && validString) {
+                    cellTable.setString(pos.row(), pos.column(), sst_idx, styleIndex(format));
+                    continue;
+                }
+
+                //Only the cells the typed storage can't hold are kept as Cell objects.
+                QSharedPointer<Cell> cell(new Cell(value, cellType, format, q));
+                cell->d_func()->formula = formula;
+                if (cellType == Cell::SharedStringType) {
+                    RichString rs = sharedStrings()->getSharedString(sst_idx);
+                    if (validString)
+                        cell->d_func()->sharedStringIndex = sst_idx;
+                    cell->d_func()->value = rs.toPlainString();
+                    if (rs.isRichString())
+                        cell->d_func()->richString = rs;
+                }
+                cellTable.setCell(pos.row(), pos.column(), cell);
             }
         }
     }
@@ -2365,23 +3349,7 @@ void WorksheetPrivate::validateDimension()
     if (dimension.isValid() || cellTable.isEmpty())
         return;
 
-    int firstRow = cellTable.constBegin().key();
-    int lastRow = (cellTable.constEnd()-1).key();
-    int firstColumn = -1;
-    int lastColumn = -1;
-
-    for (QMap<int, QMap<int, QSharedPointer<Cell> > >::const_iterator it = cellTable.begin(); it != cellTable.end(); ++it)
-    {
-        Q_ASSERT(!it.value().isEmpty());
-
-        if (firstColumn == -1 || it.value().constBegin().key() < firstColumn)
-            firstColumn = it.value().constBegin().key();
-
-        if (lastColumn == -1 || (it.value().constEnd()-1).key() > lastColumn)
-            lastColumn = (it.value().constEnd()-1).key();
-    }
-
-    CellRange cr(firstRow, firstColumn, lastRow, lastColumn);
+    CellRange cr = cellTable.boundingRange();
 
     if (cr.isValid())
         dimension = cr;
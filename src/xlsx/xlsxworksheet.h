@@ -29,7 +29,9 @@
 #include "xlsxcell.h"
 #include "xlsxcellrange.h"
 #include "xlsxcellreference.h"
+#include "xlsxrichstring.h"
 #include <QStringList>
+#include <QVector>
 #include <QMap>
 #include <QVariant>
 #include <QPointF>
@@ -59,24 +61,39 @@ class Q_XLSX_EXPORT Worksheet : public AbstractSheet
 public:
     bool write(const CellReference &row_column, const QVariant &value, const Format &format=Format());
     bool write(int row, int column, const QVariant &value, const Format &format=Format());
+    bool writeRow(int row, int firstColumn, const QVector<QVariant> &values, const Format &format=Format());
+    bool writeRow(int row, int firstColumn, const QVector<double> &values, StyleId style=StyleId());
+    bool writeRow(int row, int firstColumn, const QStringList &values, StyleId style=StyleId());
+    bool writeRange(const CellReference &topLeft, const QVector<QVector<QVariant> > &values, const Format &format=Format());
     QVariant read(const CellReference &row_column) const;
     QVariant read(int row, int column) const;
     bool writeString(const CellReference &row_column, const QString &value, const Format &format=Format());
     bool writeString(int row, int column, const QString &value, const Format &format=Format());
     bool writeString(const CellReference &row_column, const RichString &value, const Format &format=Format());
     bool writeString(int row, int column, const RichString &value, const Format &format=Format());
+    bool writeString(int row, int column, const QString &value, StyleId style);
+    bool writeString(int row, int column, StringId string, const Format &format=Format());
+    bool writeString(int row, int column, StringId string, StyleId style);
+    StringId internString(const QString &string);
     bool writeInlineString(const CellReference &row_column, const QString &value, const Format &format=Format());
     bool writeInlineString(int row, int column, const QString &value, const Format &format=Format());
     bool writeNumeric(const CellReference &row_column, double value, const Format &format=Format());
     bool writeNumeric(int row, int column, double value, const Format &format=Format());
+    bool writeNumeric(int row, int column, double value, StyleId style);
+    bool writeNumericColumn(int firstRow, int column, const double *values, int count, StyleId style=StyleId());
     bool writeFormula(const CellReference &row_column, const CellFormula &formula, const Format &format=Format(), double result=0);
     bool writeFormula(int row, int column, const CellFormula &formula, const Format &format=Format(), double result=0);
+    bool writeFormula(int row, int column, const CellFormula &formula, StyleId style, double result=0);
     bool writeBlank(const CellReference &row_column, const Format &format=Format());
     bool writeBlank(int row, int column, const Format &format=Format());
+    bool writeBlank(int row, int column, StyleId style);
     bool writeBool(const CellReference &row_column, bool value, const Format &format=Format());
     bool writeBool(int row, int column, bool value, const Format &format=Format());
+    bool writeBool(int row, int column, bool value, StyleId style);
     bool writeDateTime(const CellReference &row_column, const QDateTime& dt, const Format &format=Format());
     bool writeDateTime(int row, int column, const QDateTime& dt, const Format &format=Format());
+    bool writeDateTime(int row, int column, const QDateTime& dt, StyleId style);
+    bool writeDateTimeColumn(int firstRow, int column, const QDateTime *values, int count, StyleId style=StyleId());
     bool writeTime(const CellReference &row_column, const QTime& t, const Format &format=Format());
     bool writeTime(int row, int column, const QTime& t, const Format &format=Format());
 
@@ -140,6 +157,9 @@ public:
     bool isWhiteSpaceVisible() const;
     void setWhiteSpaceVisible(bool visible);
 
+    int streamingWindow() const;
+    void setStreamingWindow(int rows);
+
     ~Worksheet();
 
 
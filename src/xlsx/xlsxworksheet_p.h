@@ -42,21 +42,25 @@
 #include "xlsxdatavalidation.h"
 #include "xlsxconditionalformatting.h"
 #include "xlsxcellformula.h"
+#include "xlsxcelltable_p.h"
+#include "xlsxcellreference_p.h"
 
 #include <QImage>
 #include <QSharedPointer>
+#include <QScopedPointer>
 #include <QRegularExpression>
 
 class QXmlStreamWriter;
 class QXmlStreamReader;
+class QTemporaryFile;
+class QIODevice;
 
 namespace QXlsx {
 
-const int XLSX_ROW_MAX = 1048576;
-const int XLSX_COLUMN_MAX = 16384;
 const int XLSX_STRING_MAX = 32767;
 
 class SharedStrings;
+class SheetDataWriter;
 
 struct XlsxHyperlinkData
 {
@@ -80,6 +84,19 @@ struct XlsxHyperlinkData
     QString tooltip;
 };
 
+/*
+  How often the strings written to a column were already in the shared
+  strings, for the adaptive string storage policy.
+*/
+struct XlsxStringColumnStats
+{
+    XlsxStringColumnStats() : strings(0), hits(0), inlineStrings(false) {}
+
+    int strings;
+    int hits;
+    bool inlineStrings;
+};
+
 // ECMA-376 Part1 18.3.1.81
 struct XlsxSheetFormatProps
 {
@@ -157,13 +174,29 @@ public:
     ~WorksheetPrivate();
     int checkDimensions(int row, int col, bool ignore_row=false, bool ignore_col=false);
     Format cellFormat(int row, int col) const;
+    int styleIndex(const Format &format) const;
+    int styleIndex(int row, int col, StyleId style) const;
+    QSharedPointer<Cell> cellObject(int row, int col) const;
+    QVariant formulaText(int row, int col, const CellFormula &formula) const;
     QString generateDimensionString() const;
-    void calculateSpans() const;
+    void calculateSpans(int firstRow, int lastRow) const;
     void splitColsInfo(int colFirst, int colLast);
     void validateDimension();
-
-    void saveXmlSheetData(QXmlStreamWriter &writer) const;
-    void saveXmlCellData(QXmlStreamWriter &writer, int row, int col, QSharedPointer<Cell> cell) const;
+    void streamRows(int row);
+    void releaseString(int row, int col);
+    void releaseStrings();
+    void remapStrings(const QVector<int> &indexMap);
+    void writeFormula(int row, int column, const CellFormula &formula, int style, double result);
+    bool writeStringByPolicy(int row, int column, const QString &value, const Format &format);
+    bool checkRowDimensions(int row, int firstColumn, int count);
+    bool writeRowValues(int row, int firstColumn, const QVariant *values, int count, const Format &format);
+
+    void saveXmlSheetData(QIODevice *device, int firstRow, int lastRow) const;
+    void saveXmlCellStart(SheetDataWriter &writer, int row, int col, int xfIndex, int rowXfIndex) const;
+    void saveXmlCellData(SheetDataWriter &writer, int row, int col, const Cell &cell, int rowXfIndex) const;
+    void saveXmlCellText(SheetDataWriter &writer, const QString &text) const;
+    void saveXmlCellInlineString(SheetDataWriter &writer, const RichString &string) const;
+    void saveXmlCellFormula(SheetDataWriter &writer, const CellFormula &formula) const;
     void saveXmlMergeCells(QXmlStreamWriter &writer) const;
     void saveXmlHyperlinks(QXmlStreamWriter &writer) const;
     void saveXmlDrawings(QXmlStreamWriter &writer) const;
@@ -188,7 +221,7 @@ public:
 
     SharedStrings *sharedStrings() const;
 
-    QMap<int, QMap<int, QSharedPointer<Cell> > > cellTable;
+    mutable CellTable cellTable;
     QMap<int, QMap<int, QString> > comments;
     QMap<int, QMap<int, QSharedPointer<XlsxHyperlinkData> > > urlTable;
     QList<CellRange> merges;
@@ -199,11 +232,16 @@ public:
     QList<DataValidation> dataValidationsList;
     QList<ConditionalFormatting> conditionalFormattingList;
     QMap<int, CellFormula> sharedFormulaMap;
+    QHash<int, XlsxStringColumnStats> stringColumnStats;
 
     CellRange dimension;
     int previous_row;
 
-    mutable QMap<int, QString> row_spans;
+    int streamingWindow;
+    int streamedRow;
+    QScopedPointer<QTemporaryFile> streamFile;
+
+    mutable QMap<int, QPair<int, int> > row_spans; //first and last column, by block of rows
     QMap<int, double> row_sizes;
     QMap<int, double> col_sizes;
 
@@ -0,0 +1,121 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "xlsxzipcodec_p.h"
+
+#include <zlib.h>
+#include <string.h>
+
+namespace QXlsx {
+
+ZipCodec::~ZipCodec()
+{
+}
+
+namespace {
+
+class ZlibCodec : public ZipCodec
+{
+public:
+    const char *name() const { return "zlib"; }
+
+    quint32 crc32(quint32 crc, const char *data, qint64 size) const
+    {
+        return ::crc32(crc, reinterpret_cast<const Bytef *>(data), size);
+    }
+
+    quint32 crc32Combine(quint32 crc1, quint32 crc2, qint64 size2) const
+    {
+        return ::crc32_combine(crc1, crc2, size2);
+    }
+
+    bool deflateBlock(const char *data, int size, int dictSize, int level, bool last, QByteArray &output) const;
+    bool inflate(const char *data, qint64 size, char *output, qint64 outputSize) const;
+};
+
+bool ZlibCodec::deflateBlock(const char *data, int size, int dictSize, int level, bool last, QByteArray &output) const
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    if (dictSize && deflateSetDictionary(&stream, reinterpret_cast<const Bytef *>(data - dictSize), dictSize) != Z_OK) {
+        deflateEnd(&stream);
+        return false;
+    }
+
+    //The bound covers Z_FINISH, leave some room for the sync flush marker.
+    const int start = output.size();
+    output.resize(start + deflateBound(&stream, size) + 16);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef *>(output.data() + start);
+    stream.avail_out = output.size() - start;
+
+    const int ret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    const bool ok = last ? ret == Z_STREAM_END : (ret == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+    output.resize(start + stream.total_out);
+    deflateEnd(&stream);
+    return ok;
+}
+
+bool ZlibCodec::inflate(const char *data, qint64 size, char *output, qint64 outputSize) const
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        return false;
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = outputSize;
+
+    const int ret = ::inflate(&stream, Z_FINISH);
+    const bool ok = ret == Z_STREAM_END && stream.total_out == static_cast<uLong>(outputSize);
+    inflateEnd(&stream);
+    return ok;
+}
+
+} // namespace
+
+const ZipCodec *ZipCodec::zlib()
+{
+    static ZlibCodec codec;
+    return &codec;
+}
+
+/*
+  Returns the fastest backend the library has been built with.
+ */
+const ZipCodec *ZipCodec::defaultCodec()
+{
+    if (const ZipCodec *codec = zlibNg())
+        return codec;
+    return zlib();
+}
+
+} // namespace QXlsx
@@ -0,0 +1,77 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#ifndef QXLSX_XLSXZIPCODEC_P_H
+#define QXLSX_XLSXZIPCODEC_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include <QByteArray>
+
+namespace QXlsx {
+
+/*
+  The compression backend used by ZipWriter and ZipReader. All the
+  streams are raw deflate streams, i.e. without zlib header and trailer.
+ */
+class XLSX_AUTOTEST_EXPORT ZipCodec
+{
+public:
+    virtual ~ZipCodec();
+
+    virtual const char *name() const = 0;
+
+    virtual quint32 crc32(quint32 crc, const char *data, qint64 size) const = 0;
+    virtual quint32 crc32Combine(quint32 crc1, quint32 crc2, qint64 size2) const = 0;
+
+    //Deflate \a size bytes at \a data with the compression \a level and
+    //append them to \a output. The \a dictSize bytes before \a data are
+    //the preset dictionary. Unless it is the \a last one, the block ends
+    //with a sync flush so that the blocks can be concatenated.
+    virtual bool deflateBlock(const char *data, int size, int dictSize, int level,
+                              bool last, QByteArray &output) const = 0;
+
+    //Inflate the \a size bytes at \a data into the \a outputSize bytes
+    //at \a output, which must be the exact size of the inflated data.
+    virtual bool inflate(const char *data, qint64 size, char *output, qint64 outputSize) const = 0;
+
+    static const ZipCodec *zlib();
+    static const ZipCodec *zlibNg();
+    static const ZipCodec *defaultCodec();
+};
+
+} // namespace QXlsx
+
+#endif // QXLSX_XLSXZIPCODEC_P_H
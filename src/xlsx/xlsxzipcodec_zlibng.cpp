@@ -0,0 +1,126 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+
+#include "xlsxzipcodec_p.h"
+
+#ifdef XLSX_USE_ZLIB_NG
+#include <zlib-ng.h>
+#include <string.h>
+#endif
+
+namespace QXlsx {
+
+#ifdef XLSX_USE_ZLIB_NG
+
+namespace {
+
+/*
+  zlib-ng, built with its native API, is a faster drop-in for zlib.
+  Its functions and types have a zng_ prefix, so that it can be used
+  side by side with the zlib Qt itself links against.
+ */
+class ZlibNgCodec : public ZipCodec
+{
+public:
+    const char *name() const { return "zlib-ng"; }
+
+    quint32 crc32(quint32 crc, const char *data, qint64 size) const
+    {
+        return zng_crc32(crc, reinterpret_cast<const uint8_t *>(data), size);
+    }
+
+    quint32 crc32Combine(quint32 crc1, quint32 crc2, qint64 size2) const
+    {
+        return zng_crc32_combine(crc1, crc2, size2);
+    }
+
+    bool deflateBlock(const char *data, int size, int dictSize, int level, bool last, QByteArray &output) const;
+    bool inflate(const char *data, qint64 size, char *output, qint64 outputSize) const;
+};
+
+bool ZlibNgCodec::deflateBlock(const char *data, int size, int dictSize, int level, bool last, QByteArray &output) const
+{
+    zng_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (zng_deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+
+    if (dictSize && zng_deflateSetDictionary(&stream, reinterpret_cast<const uint8_t *>(data - dictSize), dictSize) != Z_OK) {
+        zng_deflateEnd(&stream);
+        return false;
+    }
+
+    //The bound covers Z_FINISH, leave some room for the sync flush marker.
+    const int start = output.size();
+    output.resize(start + zng_deflateBound(&stream, size) + 16);
+    stream.next_in = reinterpret_cast<const uint8_t *>(data);
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<uint8_t *>(output.data() + start);
+    stream.avail_out = output.size() - start;
+
+    const int ret = zng_deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    const bool ok = last ? ret == Z_STREAM_END : (ret == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+    output.resize(start + stream.total_out);
+    zng_deflateEnd(&stream);
+    return ok;
+}
+
+bool ZlibNgCodec::inflate(const char *data, qint64 size, char *output, qint64 outputSize) const
+{
+    zng_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (zng_inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        return false;
+
+    stream.next_in = reinterpret_cast<const uint8_t *>(data);
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<uint8_t *>(output);
+    stream.avail_out = outputSize;
+
+    const int ret = zng_inflate(&stream, Z_FINISH);
+    const bool ok = ret == Z_STREAM_END && stream.total_out == static_cast<size_t>(outputSize);
+    zng_inflateEnd(&stream);
+    return ok;
+}
+
+} // namespace
+
+#endif // XLSX_USE_ZLIB_NG
+
+/*
+  Returns the zlib-ng backend, or 0 if the library hasn't
+  been built with it.
+ */
+const ZipCodec *ZipCodec::zlibNg()
+{
+#ifdef XLSX_USE_ZLIB_NG
+    static ZlibNgCodec codec;
+    return &codec;
+#else
+    return 0;
+#endif
+}
+
+} // namespace QXlsx
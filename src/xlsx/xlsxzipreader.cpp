@@ -24,21 +24,72 @@
 ****************************************************************************/
 
 #include "xlsxzipreader_p.h"
+#include "xlsxzipcodec_p.h"
 
+#include <QFile>
 #include <private/qzipreader_p.h>
 
+#include <limits.h>
+
 namespace QXlsx {
 
+namespace {
+
+quint16 readUInt16(const uchar *data)
+{
+    return data[0] | (data[1] << 8);
+}
+
+quint32 readUInt32(const uchar *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (quint32(data[3]) << 24);
+}
+
+/* Size of the end of central directory record, without its comment. */
+const int EndOfDirectorySize = 22;
+const int CentralHeaderSize = 46;
+const int LocalHeaderSize = 30;
+/* Deflate can't shrink data by more than about 1032:1. */
+const qint64 MaxDeflateRatio = 1032;
+
+}
+
+/*
+ * Without an explicit codec the archive is read by QZipReader, except
+ * when a faster backend has been built in.
+ */
 ZipReader::ZipReader(const QString &filePath) :
-    m_reader(new QZipReader(filePath))
+    m_codec(0), m_device(0), m_valid(false)
 {
+#ifdef XLSX_USE_ZLIB_NG
+    m_codec = ZipCodec::defaultCodec();
+    QFile *file = new QFile(filePath);
+    file->open(QIODevice::ReadOnly);
+    m_ownDevice.reset(file);
+    m_device = file;
+    initNative();
+#else
+    m_reader.reset(new QZipReader(filePath));
     init();
+#endif
 }
 
 ZipReader::ZipReader(QIODevice *device) :
-    m_reader(new QZipReader(device))
+    m_codec(0), m_device(device), m_valid(false)
 {
+#ifdef XLSX_USE_ZLIB_NG
+    m_codec = ZipCodec::defaultCodec();
+    initNative();
+#else
+    m_reader.reset(new QZipReader(device));
     init();
+#endif
+}
+
+ZipReader::ZipReader(QIODevice *device, const ZipCodec *codec) :
+    m_codec(codec), m_device(device), m_valid(false)
+{
+    initNative();
 }
 
 ZipReader::~ZipReader()
@@ -46,6 +97,69 @@ ZipReader::~ZipReader()
 
 }
 
+void ZipReader::initNative()
+{
+    if (!m_device || !m_device->isReadable() || m_device->isSequential())
+        return;
+
+    //Find the end of central directory record, which may be followed
+    //by a comment of at most 0xffff bytes.
+    const qint64 size = m_device->size();
+    const qint64 tailSize = qMin<qint64>(size, EndOfDirectorySize + 0xffff);
+    if (tailSize < EndOfDirectorySize || !m_device->seek(size - tailSize))
+        return;
+    const QByteArray tail = m_device->read(tailSize);
+    if (tail.size() != tailSize)
+        return;
+    const uchar *t = reinterpret_cast<const uchar *>(tail.constData());
+    int pos = tail.size() - EndOfDirectorySize;
+    while (pos >= 0 && readUInt32(t + pos) != 0x06054b50)
+        --pos;
+    if (pos < 0)
+        return;
+
+    const int entryCount = readUInt16(t + pos + 10);
+    const qint64 directorySize = readUInt32(t + pos + 12);
+    const qint64 directoryOffset = readUInt32(t + pos + 16);
+    if (directoryOffset + directorySize > size || !m_device->seek(directoryOffset))
+        return;
+    const QByteArray directory = m_device->read(directorySize);
+    if (directory.size() != directorySize)
+        return;
+
+    const uchar *d = reinterpret_cast<const uchar *>(directory.constData());
+    int offset = 0;
+    for (int i=0; i<entryCount; ++i) {
+        if (offset + CentralHeaderSize > directory.size() || readUInt32(d + offset) != 0x02014b50)
+            return;
+        const uchar *header = d + offset;
+        const int nameLength = readUInt16(header + 28);
+        const int extraLength = readUInt16(header + 30);
+        const int commentLength = readUInt16(header + 32);
+        if (offset + CentralHeaderSize + nameLength > directory.size())
+            return;
+
+        const char *name = directory.constData() + offset + CentralHeaderSize;
+        const QString filePath = (readUInt16(header + 8) & 0x0800)
+                ? QString::fromUtf8(name, nameLength)
+                : QString::fromLocal8Bit(name, nameLength);
+
+        if (!filePath.endsWith(QLatin1Char('/'))) {
+            FileEntry entry;
+            entry.method = readUInt16(header + 10);
+            entry.compressedSize = readUInt32(header + 20);
+            entry.uncompressedSize = readUInt32(header + 24);
+            entry.offset = readUInt32(header + 42);
+            m_entries.insert(filePath, entry);
+            m_filePaths.append(filePath);
+        }
+
+        offset += CentralHeaderSize + nameLength + extraLength + commentLength;
+    }
+
+    m_valid = true;
+}
+
 void ZipReader::init()
 {
 #if QT_VERSION >= 0x050600
@@ -61,6 +175,8 @@ void ZipReader::init()
 
 bool ZipReader::exists() const
 {
+    if (!m_reader)
+        return m_valid;
     return m_reader->exists();
 }
 
@@ -71,7 +187,49 @@ QStringList ZipReader::filePaths() const
 
 QByteArray ZipReader::fileData(const QString &fileName) const
 {
-    return m_reader->fileData(fileName);
+    if (m_reader)
+        return m_reader->fileData(fileName);
+
+    QHash<QString, FileEntry>::const_iterator it = m_entries.constFind(fileName);
+    if (it == m_entries.constEnd())
+        return QByteArray();
+    const FileEntry &entry = it.value();
+
+    //The local header repeats the name, but its extra field may differ
+    //from the one in the central directory.
+    if (!m_device->seek(entry.offset))
+        return QByteArray();
+    const QByteArray header = m_device->read(LocalHeaderSize);
+    const uchar *h = reinterpret_cast<const uchar *>(header.constData());
+    if (header.size() != LocalHeaderSize || readUInt32(h) != 0x04034b50)
+        return QByteArray();
+    if (!m_device->seek(entry.offset + LocalHeaderSize + readUInt16(h + 26) + readUInt16(h + 28)))
+        return QByteArray();
+
+    //The sizes come from the archive, which may be corrupt or crafted,
+    //so they are checked before anything is allocated for them.
+    if (entry.compressedSize > m_device->size() - m_device->pos())
+        return QByteArray();
+    const QByteArray compressed = m_device->read(entry.compressedSize);
+    if (compressed.size() != entry.compressedSize)
+        return QByteArray();
+    if (entry.method == 0)
+        return compressed;
+    if (entry.method != 8)
+        return QByteArray();
+    if (entry.uncompressedSize > INT_MAX
+            || entry.uncompressedSize > (entry.compressedSize + 1) * MaxDeflateRatio)
+        return QByteArray();
+
+    QByteArray data(entry.uncompressedSize, Qt::Uninitialized);
+    if (!m_codec->inflate(compressed.constData(), compressed.size(), data.data(), data.size()))
+        return QByteArray();
+    return data;
+}
+
+const ZipCodec *ZipReader::codec() const
+{
+    return m_codec;
 }
 
 } // namespace QXlsx
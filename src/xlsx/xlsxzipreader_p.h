@@ -40,6 +40,7 @@
 #include "xlsxglobal.h"
 #include <QScopedPointer>
 #include <QStringList>
+#include <QHash>
 #if QT_VERSION >= 0x050600
 #include <QVector>
 #endif
@@ -48,21 +49,43 @@ class QIODevice;
 
 namespace QXlsx {
 
+class ZipCodec;
+
 class XLSX_AUTOTEST_EXPORT ZipReader
 {
 public:
     explicit ZipReader(const QString &fileName);
     explicit ZipReader(QIODevice *device);
+    ZipReader(QIODevice *device, const ZipCodec *codec);
     ~ZipReader();
     bool exists() const;
     QStringList filePaths() const;
     QByteArray fileData(const QString &fileName) const;
+    const ZipCodec *codec() const;
 
 private:
     Q_DISABLE_COPY(ZipReader)
+
+    struct FileEntry
+    {
+        quint16 method;
+        qint64 compressedSize;
+        qint64 uncompressedSize;
+        qint64 offset;
+    };
+
     void init();
+    void initNative();
+
     QScopedPointer<QZipReader> m_reader;
     QStringList m_filePaths;
+
+    //Used instead of QZipReader when a codec is given.
+    const ZipCodec *m_codec;
+    QIODevice *m_device;
+    QScopedPointer<QIODevice> m_ownDevice;
+    QHash<QString, FileEntry> m_entries;
+    bool m_valid;
 };
 
 } // namespace QXlsx
@@ -23,46 +23,633 @@
 **
 ****************************************************************************/
 #include "xlsxzipwriter_p.h"
+#include "xlsxzipcodec_p.h"
+
+#include <QFile>
+#include <QDateTime>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
 #include <QDebug>
-#include <private/qzipwriter_p.h>
+
+#include <string.h>
 
 namespace QXlsx {
 
-ZipWriter::ZipWriter(const QString &filePath)
+//The deflate stream of an entry is made of independent blocks, which
+//only share the preceding 32K of data as a preset dictionary, so they
+//can be compressed concurrently as pigz does.
+static const int DeflateBlockSize = 128 * 1024;
+static const int DeflateDictionarySize = 32 * 1024;
+
+static void appendUShort(QByteArray &data, quint16 value)
+{
+    data.append(static_cast<char>(value & 0xff));
+    data.append(static_cast<char>((value >> 8) & 0xff));
+}
+
+static void appendUInt(QByteArray &data, quint32 value)
+{
+    appendUShort(data, value & 0xffff);
+    appendUShort(data, (value >> 16) & 0xffff);
+}
+
+namespace {
+
+struct DeflateBlock
+{
+    const ZipCodec *codec;
+    const char *data;
+    int size;
+    int dictSize;
+    int level;
+    bool last;
+};
+
+struct DeflatedBlock
+{
+    QByteArray data;
+    quint32 crc;
+    bool ok;
+};
+
+DeflatedBlock deflateBlockJob(const DeflateBlock &block)
 {
-    m_writer = new QZipWriter(filePath, QIODevice::WriteOnly);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    DeflatedBlock result;
+    result.crc = block.codec->crc32(0, block.data, block.size);
+    result.ok = block.codec->deflateBlock(block.data, block.size, block.dictSize, block.level, block.last, result.data);
+    return result;
 }
 
-ZipWriter::ZipWriter(QIODevice *device)
+} // namespace
+
+/*
+  Deflate the whole \a data with the \a codec and compression \a level,
+  block by block, and compute its \a crc.
+  When \a parallel is true, the blocks are deflated concurrently, the
+  result is the same. The caller takes part in the work, so this can
+  safely be called from a thread of the pool as well.
+ */
+static QByteArray deflateData(const ZipCodec *codec, const QByteArray &data, int level, bool parallel, quint32 *crc, bool *ok)
 {
-    m_writer = new QZipWriter(device);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    QList<DeflateBlock> blocks;
+    int offset = 0;
+    do {
+        DeflateBlock block;
+        block.codec = codec;
+        block.data = data.constData() + offset;
+        block.size = qMin(data.size() - offset, DeflateBlockSize);
+        block.dictSize = qMin(offset, DeflateDictionarySize);
+        block.level = level;
+        block.last = offset + block.size == data.size();
+        blocks.append(block);
+        offset += block.size;
+    } while (offset < data.size());
+
+    QList<DeflatedBlock> results;
+    if (parallel && blocks.size() > 1) {
+        results = QtConcurrent::blockingMapped(blocks, deflateBlockJob);
+    } else {
+        foreach (const DeflateBlock &block, blocks)
+            results.append(deflateBlockJob(block));
+    }
+
+    QByteArray compressed;
+    *crc = 0;
+    *ok = true;
+    for (int i=0; i<results.size(); ++i) {
+        compressed.append(results[i].data);
+        *crc = codec->crc32Combine(*crc, results[i].crc, blocks[i].size);
+        *ok = *ok && results[i].ok;
+    }
+    return compressed;
+}
+
+/*
+  Write-only device returned by ZipWriter::beginFile(). The data written
+  to it is deflated block by block and passed on to the zip device, so
+  only the current block and its dictionary are held in memory. With
+  a compression level of 0, the data is passed on as is.
+ */
+class ZipEntryDevice : public QIODevice
+{
+public:
+    ZipEntryDevice(ZipWriter *writer, int level);
+
+    bool isSequential() const { return true; }
+    bool finish();
+
+    quint32 crc;
+    qint64 uncompressedSize;
+    qint64 compressedSize;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private:
+    bool deflateInput(bool last);
+
+    ZipWriter *m_writer;
+    int m_level;
+    bool m_valid;
+    QByteArray m_input; //dictionary followed by the current block
+    int m_dictSize;
+    QByteArray m_output;
+};
+
+ZipEntryDevice::ZipEntryDevice(ZipWriter *writer, int level) :
+    crc(0), uncompressedSize(0), compressedSize(0), m_writer(writer)
+    , m_level(level), m_valid(true), m_dictSize(0)
+{
+    if (m_level != 0)
+        m_input.reserve(DeflateDictionarySize + DeflateBlockSize);
+    open(QIODevice::WriteOnly);
+}
+
+bool ZipEntryDevice::finish()
+{
+    bool ok = m_valid && (m_level == 0 || deflateInput(true));
+    close();
+    return ok;
+}
+
+qint64 ZipEntryDevice::readData(char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+qint64 ZipEntryDevice::writeData(const char *data, qint64 size)
+{
+    if (!m_valid)
+        return -1;
+
+    if (m_level == 0) {
+        crc = m_writer->m_codec->crc32(crc, data, size);
+        m_writer->writeData(data, size);
+        uncompressedSize += size;
+        compressedSize += size;
+        return size;
+    }
+
+    //Small writes, such as the ones of QXmlStreamWriter, are collected
+    //into blocks. A full block is only deflated once more data follows,
+    //as the last block of the stream is finished differently.
+    const char *end = data + size;
+    while (data < end) {
+        if (m_input.size() - m_dictSize == DeflateBlockSize && !deflateInput(false)) {
+            m_valid = false;
+            return -1;
+        }
+        const int count = qMin<qint64>(end - data, DeflateBlockSize - (m_input.size() - m_dictSize));
+        m_input.append(data, count);
+        data += count;
+    }
+    uncompressedSize += size;
+    return size;
+}
+
+bool ZipEntryDevice::deflateInput(bool last)
+{
+    const char *block = m_input.constData() + m_dictSize;
+    const int blockSize = m_input.size() - m_dictSize;
+    crc = m_writer->m_codec->crc32(crc, block, blockSize);
+
+    m_output.resize(0);
+    if (!m_writer->m_codec->deflateBlock(block, blockSize, m_dictSize, m_level, last, m_output))
+        return false;
+    m_writer->writeData(m_output.constData(), m_output.size());
+    compressedSize += m_output.size();
+
+    //Keep the tail of the data as dictionary of the next block.
+    const int dictSize = qMin(m_input.size(), DeflateDictionarySize);
+    memmove(m_input.data(), m_input.constData() + m_input.size() - dictSize, dictSize);
+    m_input.resize(dictSize);
+    m_dictSize = dictSize;
+    return true;
+}
+
+ZipWriter::ZipWriter(const QString &filePath) :
+    m_device(new QFile(filePath)), m_ownDevice(true), m_error(false)
+{
+    if (!m_device->open(QIODevice::WriteOnly))
+        m_error = true;
+    init();
+}
+
+ZipWriter::ZipWriter(QIODevice *device) :
+    m_device(device), m_ownDevice(false), m_error(false)
+{
+    if (!m_device->isOpen() && !m_device->open(QIODevice::WriteOnly))
+        m_error = true;
+    init();
 }
 
 ZipWriter::~ZipWriter()
 {
-    delete m_writer;
+    close();
+    if (m_ownDevice)
+        delete m_device;
+}
+
+void ZipWriter::init()
+{
+    m_closed = false;
+    m_entryDevice = 0;
+    m_parallel = false;
+    m_level = -1;
+    m_codec = ZipCodec::defaultCodec();
+    m_offset = m_device->isSequential() ? 0 : m_device->pos();
+
+    //All the entries share the time the archive is created at, in MS-DOS format.
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDate date = now.date();
+    const QTime time = now.time();
+    m_time = (time.hour() << 11) | (time.minute() << 5) | (time.second() >> 1);
+    m_date = ((date.year() - 1980) << 9) | (date.month() << 5) | date.day();
 }
 
 bool ZipWriter::error() const
 {
-    return m_writer->status() != QZipWriter::NoError;
+    return m_error;
 }
 
 void ZipWriter::addFile(const QString &filePath, QIODevice *device)
 {
-    m_writer->addFile(filePath, device);
+    bool opened = false;
+    if (!device->isOpen()) {
+        if (!device->open(QIODevice::ReadOnly)) {
+            m_error = true;
+            return;
+        }
+        opened = true;
+    }
+
+    addFile(filePath, device->readAll());
+
+    if (opened)
+        device->close();
 }
 
 void ZipWriter::addFile(const QString &filePath, const QByteArray &data)
 {
-    m_writer->addFile(filePath, data);
+    endFile();
+
+    const int level = compressionLevel(filePath);
+    if (m_parallel) {
+        queueEntry(createEntry(filePath, 0, 0), QtConcurrent::run(&ZipWriter::compressData, m_codec, data, level, true, true));
+    } else {
+        writePendingEntries(0);
+        writeEntry(createEntry(filePath, 0, 0), compressData(m_codec, data, level, true, false));
+    }
+}
+
+/*
+  Start a new entry \a filePath and return the device its contents
+  should be written to. The device is valid until endFile(), close()
+  or the next addFile() or beginFile() call.
+ */
+QIODevice *ZipWriter::beginFile(const QString &filePath)
+{
+    endFile();
+
+    //The local header of an entry written to a sequential device
+    //can't be updated, so its crc and sizes will follow the data
+    //in a data descriptor instead.
+    const quint16 flags = m_device->isSequential() ? 0x0008 : 0;
+    const int level = compressionLevel(filePath);
+    const quint16 method = level == 0 ? 0 : 8;
+
+    //The entry is streamed even when parallel compression is enabled,
+    //so its contents are never held in memory as a whole.
+    writePendingEntries(0);
+    FileEntry entry = createEntry(filePath, method, flags);
+    writeLocalHeader(entry);
+    m_entries.append(entry);
+
+    m_entryDevice = new ZipEntryDevice(this, level);
+    return m_entryDevice;
+}
+
+/*
+  Add the entry \a filePath with the \a data, which comes out the same
+  as if the data had been written to the device returned by
+  beginFile(). Unlike the entries of beginFile(), the ones of
+  writeFile() are compressed by the thread pool when parallel
+  compression is enabled, so it's meant for contents which are already
+  in memory anyway.
+ */
+void ZipWriter::writeFile(const QString &filePath, const QByteArray &data)
+{
+    endFile();
+
+    const quint16 flags = m_device->isSequential() ? 0x0008 : 0;
+    const int level = compressionLevel(filePath);
+    const FileEntry entry = createEntry(filePath, level == 0 ? 0 : 8, flags);
+    if (m_parallel) {
+        queueEntry(entry, QtConcurrent::run(&ZipWriter::compressData, m_codec, data, level, false, true));
+    } else {
+        writePendingEntries(0);
+        writeEntry(entry, compressData(m_codec, data, level, false, false));
+    }
+}
+
+void ZipWriter::endFile()
+{
+    if (!m_entryDevice)
+        return;
+
+    if (!m_entryDevice->finish())
+        m_error = true;
+
+    FileEntry &entry = m_entries.last();
+    entry.crc = m_entryDevice->crc;
+    entry.compressedSize = m_entryDevice->compressedSize;
+    entry.uncompressedSize = m_entryDevice->uncompressedSize;
+    delete m_entryDevice;
+    m_entryDevice = 0;
+
+    if (entry.flags & 0x0008) {
+        writeDataDescriptor(entry);
+    } else {
+        QByteArray fields;
+        appendUInt(fields, entry.crc);
+        appendUInt(fields, entry.compressedSize);
+        appendUInt(fields, entry.uncompressedSize);
+
+        const qint64 pos = m_device->pos();
+        if (!m_device->seek(entry.offset + 14)
+                || m_device->write(fields) != fields.size()
+                || !m_device->seek(pos)) {
+            m_error = true;
+        }
+    }
 }
 
 void ZipWriter::close()
 {
-    m_writer->close();
+    if (m_closed)
+        return;
+
+    endFile();
+    writePendingEntries(0);
+    writeCentralDirectory();
+    m_closed = true;
+
+    if (m_ownDevice)
+        m_device->close();
+}
+
+bool ZipWriter::isParallelCompressionEnabled() const
+{
+    return m_parallel;
+}
+
+/*
+  When \a enable is true, the entries of addFile() and writeFile() are
+  compressed concurrently by the threads of QThreadPool::globalInstance().
+  They are still written in the order they were added, so the archive
+  is the same either way. The entries of beginFile() are always streamed.
+ */
+void ZipWriter::setParallelCompressionEnabled(bool enable)
+{
+    m_parallel = enable;
+}
+
+const ZipCodec *ZipWriter::codec() const
+{
+    return m_codec;
+}
+
+/*
+  Set the compression backend used for the entries added from now on.
+ */
+void ZipWriter::setCodec(const ZipCodec *codec)
+{
+    m_codec = codec;
+}
+
+int ZipWriter::compressionLevel() const
+{
+    return m_level;
+}
+
+/*
+  Set the default compression \a level of the entries, from 1 (fastest)
+  to 9 (smallest). Level 0 stores the entries without compression and
+  -1, the default, stands for the default level of the codec.
+ */
+void ZipWriter::setCompressionLevel(int level)
+{
+    m_level = qBound(-1, level, 9);
+}
+
+/*
+  Override the compression \a level of the entries whose path matches
+  the wildcard \a pattern, such as "xl/media/*". When several patterns
+  match, the one set last wins.
+ */
+void ZipWriter::setCompressionLevel(const QString &pattern, int level)
+{
+    for (int i=0; i<m_levelOverrides.size(); ++i) {
+        if (m_levelOverrides[i].first.pattern() == pattern) {
+            m_levelOverrides.removeAt(i);
+            break;
+        }
+    }
+    m_levelOverrides.append(qMakePair(QRegExp(pattern, Qt::CaseSensitive, QRegExp::Wildcard), qBound(-1, level, 9)));
+}
+
+/*
+  Returns the compression level used for the entry \a filePath.
+ */
+int ZipWriter::compressionLevel(const QString &filePath) const
+{
+    for (int i=m_levelOverrides.size()-1; i>=0; --i) {
+        if (m_levelOverrides[i].first.exactMatch(filePath))
+            return m_levelOverrides[i].second;
+    }
+    return m_level;
+}
+
+/*
+  Deflate \a data with the \a codec and compression \a level, the blocks of large
+  entries are deflated concurrently if \a parallel is true. When
+  \a autoStore is true, the data is stored instead if deflating it
+  doesn't make it smaller, same as QZipWriter::AutoCompress. Level 0
+  always stores the data.
+ */
+ZipWriter::CompressedData ZipWriter::compressData(const ZipCodec *codec, const QByteArray &data, int level, bool autoStore, bool parallel)
+{
+    CompressedData result;
+    if (level == 0) {
+        result.data = data;
+        result.method = 0;
+        result.crc = codec->crc32(0, data.constData(), data.size());
+        result.uncompressedSize = data.size();
+        result.ok = true;
+        return result;
+    }
+
+    result.data = deflateData(codec, data, level, parallel, &result.crc, &result.ok);
+    result.method = 8;
+    result.uncompressedSize = data.size();
+    if (autoStore && (!result.ok || result.data.size() >= data.size())) {
+        result.data = data;
+        result.method = 0;
+        result.ok = true;
+    }
+    return result;
+}
+
+ZipWriter::FileEntry ZipWriter::createEntry(const QString &filePath, quint16 method, quint16 flags) const
+{
+    FileEntry entry;
+    entry.name = filePath.toUtf8();
+    entry.flags = flags;
+    entry.method = method;
+    entry.crc = 0;
+    entry.compressedSize = 0;
+    entry.uncompressedSize = 0;
+    entry.offset = m_offset;
+
+    //Bit 11 tells that the name isn't plain ascii but utf8.
+    for (int i=0; i<entry.name.size(); ++i) {
+        if (static_cast<uchar>(entry.name[i]) >= 0x80) {
+            entry.flags |= 0x0800;
+            break;
+        }
+    }
+
+    return entry;
+}
+
+void ZipWriter::queueEntry(const FileEntry &entry, const QFuture<CompressedData> &result)
+{
+    PendingEntry pending;
+    pending.entry = entry;
+    pending.result = result;
+    m_pending.append(pending);
+
+    //Bound the memory held by the entries waiting to be written.
+    writePendingEntries(QThreadPool::globalInstance()->maxThreadCount() * 2);
+}
+
+/*
+  Write the compressed entries in the order they were queued, waiting
+  for the oldest one as long as more than \a maxPending are left.
+ */
+void ZipWriter::writePendingEntries(int maxPending)
+{
+    while (!m_pending.isEmpty()
+           && (m_pending.size() > maxPending || m_pending.first().result.isFinished())) {
+        PendingEntry pending = m_pending.takeFirst();
+        writeEntry(pending.entry, pending.result.result());
+    }
+}
+
+void ZipWriter::writeEntry(FileEntry entry, const CompressedData &compressed)
+{
+    if (!compressed.ok)
+        m_error = true;
+
+    entry.method = compressed.method;
+    entry.crc = compressed.crc;
+    entry.compressedSize = compressed.data.size();
+    entry.uncompressedSize = compressed.uncompressedSize;
+    entry.offset = m_offset;
+
+    writeLocalHeader(entry);
+    writeData(compressed.data.constData(), compressed.data.size());
+    if (entry.flags & 0x0008)
+        writeDataDescriptor(entry);
+    m_entries.append(entry);
+}
+
+void ZipWriter::writeLocalHeader(const FileEntry &entry)
+{
+    QByteArray header;
+    appendUInt(header, 0x04034b50);
+    appendUShort(header, 20); //version needed to extract
+    appendUShort(header, entry.flags);
+    appendUShort(header, entry.method);
+    appendUShort(header, m_time);
+    appendUShort(header, m_date);
+    //With a data descriptor, these fields are zero.
+    const bool hasDescriptor = entry.flags & 0x0008;
+    appendUInt(header, hasDescriptor ? 0 : entry.crc);
+    appendUInt(header, hasDescriptor ? 0 : entry.compressedSize);
+    appendUInt(header, hasDescriptor ? 0 : entry.uncompressedSize);
+    appendUShort(header, entry.name.size());
+    appendUShort(header, 0); //extra field length
+    header.append(entry.name);
+
+    writeData(header.constData(), header.size());
+}
+
+void ZipWriter::writeDataDescriptor(const FileEntry &entry)
+{
+    QByteArray descriptor;
+    appendUInt(descriptor, 0x08074b50);
+    appendUInt(descriptor, entry.crc);
+    appendUInt(descriptor, entry.compressedSize);
+    appendUInt(descriptor, entry.uncompressedSize);
+    writeData(descriptor.constData(), descriptor.size());
+}
+
+void ZipWriter::writeCentralDirectory()
+{
+    const qint64 start = m_offset;
+    foreach (const FileEntry &entry, m_entries) {
+        //Zip64 isn't supported.
+        if (entry.compressedSize > 0xffffffffLL || entry.uncompressedSize > 0xffffffffLL
+                || entry.offset > 0xffffffffLL) {
+            m_error = true;
+        }
+
+        QByteArray header;
+        appendUInt(header, 0x02014b50);
+        appendUShort(header, 20); //version made by, MS-DOS
+        appendUShort(header, 20); //version needed to extract
+        appendUShort(header, entry.flags);
+        appendUShort(header, entry.method);
+        appendUShort(header, m_time);
+        appendUShort(header, m_date);
+        appendUInt(header, entry.crc);
+        appendUInt(header, entry.compressedSize);
+        appendUInt(header, entry.uncompressedSize);
+        appendUShort(header, entry.name.size());
+        appendUShort(header, 0); //extra field length
+        appendUShort(header, 0); //file comment length
+        appendUShort(header, 0); //disk number start
+        appendUShort(header, 0); //internal file attributes
+        appendUInt(header, 0); //external file attributes
+        appendUInt(header, entry.offset);
+        header.append(entry.name);
+
+        writeData(header.constData(), header.size());
+    }
+
+    QByteArray end;
+    appendUInt(end, 0x06054b50);
+    appendUShort(end, 0); //number of this disk
+    appendUShort(end, 0); //disk where the central directory starts
+    appendUShort(end, m_entries.size());
+    appendUShort(end, m_entries.size());
+    appendUInt(end, m_offset - start);
+    appendUInt(end, start);
+    appendUShort(end, 0); //comment length
+
+    writeData(end.constData(), end.size());
+}
+
+void ZipWriter::writeData(const char *data, qint64 size)
+{
+    if (m_device->write(data, size) != size)
+        m_error = true;
+    m_offset += size;
 }
 
 } // namespace QXlsx
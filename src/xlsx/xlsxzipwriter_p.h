@@ -36,13 +36,21 @@
 // We mean it.
 //
 
+#include "xlsxglobal.h"
 #include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QRegExp>
+#include <QFuture>
 class QIODevice;
-class QZipWriter;
 
 namespace QXlsx {
 
-class ZipWriter
+class ZipEntryDevice;
+class ZipCodec;
+
+class XLSX_AUTOTEST_EXPORT ZipWriter
 {
 public:
     explicit ZipWriter(const QString &filePath);
@@ -51,11 +59,80 @@ public:
 
     void addFile(const QString &filePath, QIODevice *device);
     void addFile(const QString &filePath, const QByteArray &data);
+    void writeFile(const QString &filePath, const QByteArray &data);
+    QIODevice *beginFile(const QString &filePath);
+    void endFile();
     bool error() const;
     void close();
 
+    bool isParallelCompressionEnabled() const;
+    void setParallelCompressionEnabled(bool enable);
+
+    const ZipCodec *codec() const;
+    void setCodec(const ZipCodec *codec);
+
+    int compressionLevel() const;
+    void setCompressionLevel(int level);
+    void setCompressionLevel(const QString &pattern, int level);
+    int compressionLevel(const QString &filePath) const;
+
 private:
-    QZipWriter *m_writer;
+    Q_DISABLE_COPY(ZipWriter)
+    friend class ZipEntryDevice;
+
+    struct FileEntry
+    {
+        QByteArray name;
+        quint16 flags;
+        quint16 method;
+        quint32 crc;
+        qint64 compressedSize;
+        qint64 uncompressedSize;
+        qint64 offset;
+    };
+
+    struct CompressedData
+    {
+        QByteArray data;
+        quint16 method;
+        quint32 crc;
+        qint64 uncompressedSize;
+        bool ok;
+    };
+
+    struct PendingEntry
+    {
+        FileEntry entry;
+        QFuture<CompressedData> result;
+    };
+
+    static CompressedData compressData(const ZipCodec *codec, const QByteArray &data, int level,
+                                       bool autoStore, bool parallel);
+
+    void init();
+    FileEntry createEntry(const QString &filePath, quint16 method, quint16 flags) const;
+    void queueEntry(const FileEntry &entry, const QFuture<CompressedData> &result);
+    void writePendingEntries(int maxPending);
+    void writeEntry(FileEntry entry, const CompressedData &compressed);
+    void writeLocalHeader(const FileEntry &entry);
+    void writeDataDescriptor(const FileEntry &entry);
+    void writeCentralDirectory();
+    void writeData(const char *data, qint64 size);
+
+    QIODevice *m_device;
+    bool m_ownDevice;
+    bool m_closed;
+    bool m_error;
+    qint64 m_offset;
+    quint16 m_time;
+    quint16 m_date;
+    QList<FileEntry> m_entries;
+    ZipEntryDevice *m_entryDevice;
+    bool m_parallel;
+    QList<PendingEntry> m_pending;
+    const ZipCodec *m_codec;
+    int m_level;
+    QList<QPair<QRegExp, int> > m_levelOverrides;
 };
 
 } // namespace QXlsx
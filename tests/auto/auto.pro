@@ -3,6 +3,7 @@ SUBDIRS=\
     utility \
     worksheet \
     zipreader \
+    zipwriter \
     relationships \
     propscore \
     propsapp \
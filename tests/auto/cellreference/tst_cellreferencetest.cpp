@@ -30,6 +30,10 @@ void CellReferenceTest::test_fromString()
     CellReference pos(cell);
     QCOMPARE(pos.row(), row);
     QCOMPARE(pos.column(), col);
+
+    CellReference pos2(cell.toLatin1().constData());
+    QCOMPARE(pos2.row(), row);
+    QCOMPARE(pos2.column(), col);
 }
 
 void CellReferenceTest::test_fromString_data()
@@ -50,6 +54,13 @@ void CellReferenceTest::test_fromString_data()
     QTest::newRow("IU2") << "IU2" << 2 << 255;
     QTest::newRow("XFD1") << "XFD1" << 1 << 16384;
     QTest::newRow("XFE1048577") << "XFE1048577" << 1048577 << 16385;
+    QTest::newRow("lower case") << "a1" << -1 << -1;
+    QTest::newRow("no row") << "A" << -1 << -1;
+    QTest::newRow("no column") << "$1" << -1 << -1;
+    QTest::newRow("four letters") << "ABCD1" << -1 << -1;
+    QTest::newRow("trailing $") << "A1$" << -1 << -1;
+    QTest::newRow("overflow") << "A99999999999" << -1 << -1;
+    QTest::newRow("empty") << "" << -1 << -1;
 }
 
 void CellReferenceTest::test_toString()
@@ -75,6 +86,8 @@ void CellReferenceTest::test_toString_data()
     QTest::newRow("rowabs") << 1 << 1 << true << false << "A$1";
     QTest::newRow("colabs") << 1 << 1 << false << true << "$A1";
     QTest::newRow("bothabs") << 1 << 1 << true << true << "$A$1";
+    QTest::newRow("AA") << 2 << 27 << false << false << "AA2";
+    QTest::newRow("XFD") << 3 << 16384 << false << false << "XFD3";
     QTest::newRow("...") << 1048577 << 16385 << false << false << "XFE1048577";
 }
 
@@ -2,6 +2,10 @@
 #include "xlsxcell.h"
 #include "xlsxformat.h"
 #include "xlsxcellformula.h"
+#include "xlsxcellrange.h"
+#include "xlsxchart.h"
+#include "xlsxdatavalidation.h"
+#include "private/xlsxzipreader_p.h"
 #include <QString>
 #include <QtTest>
 
@@ -28,6 +32,10 @@ private Q_SLOTS:
     void testMoveWorksheet();
     void testDeleteWorksheet();
     void testCopyWorksheet();
+
+    void testParallelSave();
+    void testParallelSaveStreaming();
+    void testCompactSharedStrings();
 };
 
 DocumentTest::DocumentTest()
@@ -360,6 +368,125 @@ void DocumentTest::testDeleteWorksheet()
     QCOMPARE(xlsx1.sheetNames(), QStringList()<<"Sheet3");
 }
 
+void DocumentTest::testParallelSave()
+{
+    Document xlsx1;
+    QVERIFY(!xlsx1.isParallelSaveEnabled());
+    for (int sheet=0; sheet<4; ++sheet) {
+        if (sheet)
+            xlsx1.addSheet();
+        for (int row=1; row<=500; ++row) {
+            xlsx1.write(row, 1, QString("Text %1").arg(row % 50));
+            xlsx1.write(row, 2, row * 1.5);
+            xlsx1.write(row, 3, QString("=B%1*2").arg(row));
+        }
+        xlsx1.mergeCells("E1:F2");
+        DataValidation validation(DataValidation::Whole, DataValidation::LessThan, "10");
+        validation.addRange("D1:D10");
+        xlsx1.addDataValidation(validation);
+        Chart *chart = xlsx1.insertChart(3, 5, QSize(300, 300));
+        chart->addSeries(CellRange("B1:B50"));
+    }
+    xlsx1.addSheet("Chart", AbstractSheet::ST_ChartSheet);
+
+    QBuffer sequential;
+    sequential.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&sequential));
+
+    xlsx1.setParallelSaveEnabled(true);
+    QVERIFY(xlsx1.isParallelSaveEnabled());
+    QBuffer parallel;
+    parallel.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&parallel));
+
+    //Only the time stamps may differ between the two packages.
+    sequential.open(QIODevice::ReadOnly);
+    parallel.open(QIODevice::ReadOnly);
+    QCOMPARE(parallel.size(), sequential.size());
+    ZipReader reader1(&sequential);
+    ZipReader reader2(&parallel);
+    QCOMPARE(reader2.filePaths(), reader1.filePaths());
+    foreach (QString path, reader1.filePaths()) {
+        if (path != QLatin1String("docProps/core.xml"))
+            QCOMPARE(reader2.fileData(path), reader1.fileData(path));
+    }
+}
+
+void DocumentTest::testParallelSaveStreaming()
+{
+    Document xlsx1;
+    xlsx1.currentWorksheet()->setStreamingWindow(16);
+    for (int row=1; row<=2000; ++row) {
+        xlsx1.write(row, 1, row);
+        xlsx1.write(row, 2, QString("Text %1").arg(row % 50));
+    }
+
+    QBuffer sequential;
+    sequential.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&sequential));
+
+    //The streamed sheet is written through the zip, as without parallel save.
+    xlsx1.setParallelSaveEnabled(true);
+    QBuffer parallel;
+    parallel.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&parallel));
+
+    sequential.open(QIODevice::ReadOnly);
+    parallel.open(QIODevice::ReadOnly);
+    QCOMPARE(parallel.size(), sequential.size());
+    ZipReader reader1(&sequential);
+    ZipReader reader2(&parallel);
+    QCOMPARE(reader2.filePaths(), reader1.filePaths());
+    QCOMPARE(reader2.fileData("xl/worksheets/sheet1.xml"), reader1.fileData("xl/worksheets/sheet1.xml"));
+
+    parallel.seek(0);
+    Document xlsx2(&parallel);
+    QCOMPARE(xlsx2.read(1, 1).toInt(), 1);
+    QCOMPARE(xlsx2.read(2000, 1).toInt(), 2000);
+    QCOMPARE(xlsx2.read(2000, 2).toString(), QString("Text 0"));
+}
+
+void DocumentTest::testCompactSharedStrings()
+{
+    Document xlsx1;
+    xlsx1.write("A1", "Old");
+    xlsx1.write("A2", "Keep");
+    xlsx1.write("A3", "Old");
+    xlsx1.write("A1", "New");
+    xlsx1.write("A3", 3);
+    xlsx1.addSheet();
+    xlsx1.write("A1", "Gone");
+    xlsx1.addSheet();
+    xlsx1.write("A1", "New");
+    xlsx1.deleteSheet("Sheet2");
+
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&device));
+
+    ZipReader reader(&device);
+    QByteArray sst = reader.fileData(QStringLiteral("xl/sharedStrings.xml"));
+    QVERIFY(sst.contains("count=\"3\" uniqueCount=\"2\""));
+    QVERIFY(!sst.contains("Old"));
+    QVERIFY(!sst.contains("Gone"));
+
+    //The indices of the cells follow the compacted table.
+    device.open(QIODevice::ReadOnly);
+    Document xlsx2(&device);
+    QCOMPARE(xlsx2.read("A1").toString(), QString("New"));
+    QCOMPARE(xlsx2.read("A2").toString(), QString("Keep"));
+    QCOMPARE(xlsx2.read("A3").toInt(), 3);
+    xlsx2.selectSheet("Sheet3");
+    QCOMPARE(xlsx2.read("A1").toString(), QString("New"));
+
+    //Saving again keeps the strings.
+    QBuffer device2;
+    device2.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx2.saveAs(&device2));
+    ZipReader reader2(&device2);
+    QCOMPARE(reader2.fileData(QStringLiteral("xl/sharedStrings.xml")), sst);
+}
+
 QTEST_APPLESS_MAIN(DocumentTest)
 
 #include "tst_documenttest.moc"
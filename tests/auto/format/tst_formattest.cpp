@@ -14,6 +14,8 @@ public:
 private Q_SLOTS:
     void testDateTimeFormat();
     void testDateTimeFormat_data();
+    void testFormatKey();
+    void testMergeFormat();
 };
 
 FormatTest::FormatTest()
@@ -52,6 +54,70 @@ void FormatTest::testDateTimeFormat_data()
     QTest::newRow("23") << QString("###;m/d/yy")<<false;
 }
 
+void FormatTest::testFormatKey()
+{
+    QVERIFY(Format().formatKey().isEmpty());
+
+    Format fmt1;
+    fmt1.setFontBold(true);
+    fmt1.setFontColor(Qt::red);
+    fmt1.setPatternBackgroundColor(Qt::blue);
+    fmt1.setNumberFormat(QStringLiteral("0.00"));
+
+    //Same properties set in another order
+    Format fmt2;
+    fmt2.setNumberFormat(QStringLiteral("0.00"));
+    fmt2.setPatternBackgroundColor(Qt::blue);
+    fmt2.setFontColor(Qt::red);
+    fmt2.setFontBold(true);
+
+    QCOMPARE(fmt1.formatKey(), fmt2.formatKey());
+    QCOMPARE(fmt1.fontKey(), fmt2.fontKey());
+    QCOMPARE(fmt1.fillKey(), fmt2.fillKey());
+    QVERIFY(fmt1 == fmt2);
+
+    fmt2.setFontColor(Qt::green);
+    QVERIFY(fmt1.formatKey() != fmt2.formatKey());
+    QVERIFY(fmt1.fontKey() != fmt2.fontKey());
+    QCOMPARE(fmt1.fillKey(), fmt2.fillKey());
+    QVERIFY(fmt1.borderKey().isEmpty());
+
+    fmt2.setFontColor(Qt::red);
+    QVERIFY(fmt1 == fmt2);
+}
+
+void FormatTest::testMergeFormat()
+{
+    Format base;
+    base.setFontBold(true);
+    base.setHorizontalAlignment(Format::AlignHCenter);
+    const Format copy = base;
+
+    Format modifier;
+    modifier.setFontBold(true);
+    modifier.setFontItalic(true);
+    modifier.setPatternBackgroundColor(Qt::yellow);
+
+    base.mergeFormat(modifier);
+    QVERIFY(base.fontBold());
+    QVERIFY(base.fontItalic());
+    QCOMPARE(base.horizontalAlignment(), Format::AlignHCenter);
+    QCOMPARE(base.patternBackgroundColor(), QColor(Qt::yellow));
+    QVERIFY(base.hasFillData());
+    QVERIFY(!base.hasBorderData());
+
+    //The copy is left alone
+    QVERIFY(!copy.fontItalic());
+    QVERIFY(!copy.hasFillData());
+
+    base.setFontItalic(false);
+    base.setPatternBackgroundColor(QColor());
+    base.setFillPattern(Format::PatternNone);
+    QVERIFY(!base.hasFillData());
+    QCOMPARE(base.fontKey(), copy.fontKey());
+    QVERIFY(base == copy);
+}
+
 QTEST_APPLESS_MAIN(FormatTest)
 
 #include "tst_formattest.moc"
@@ -14,7 +14,10 @@ public:
 
 private Q_SLOTS:
     void testAddSharedString();
+    void testAddPlainString();
     void testRemoveSharedString();
+    void testCompact();
+    void testInternString();
 
     void testLoadXmlData();
     void testLoadRichStringXmlData();
@@ -66,6 +69,31 @@ void SharedStringsTest::testAddSharedString()
     QCOMPARE(uniqueCount, 5);
 }
 
+void SharedStringsTest::testAddPlainString()
+{
+    QXlsx::SharedStrings sst(QXlsx::SharedStrings::F_NewFromScratch);
+    QCOMPARE(sst.addSharedString(QStringLiteral("Hello Qt!")), 0);
+
+    //A single fragment is looked up as a plain string.
+    QXlsx::RichString rs(QStringLiteral("Hello Qt!"));
+    QCOMPARE(sst.addSharedString(rs), 0);
+
+    QXlsx::RichString rs2;
+    rs2.addFragment("Hello", QXlsx::Format());
+    rs2.addFragment(" Qt!", QXlsx::Format());
+    QCOMPARE(sst.addSharedString(rs2), 1);
+    QCOMPARE(sst.addSharedString(QStringLiteral("Hello Qt!")), 0);
+
+    QCOMPARE(sst.count(), 4);
+    QCOMPARE(sst.uniqueCount(), 2);
+    QCOMPARE(sst.getSharedStringIndex(QStringLiteral("Hello Qt!")), 0);
+    QCOMPARE(sst.getSharedStringIndex(rs2), 1);
+    QCOMPARE(sst.getSharedPlainString(0), QStringLiteral("Hello Qt!"));
+    QCOMPARE(sst.getSharedPlainString(1), QStringLiteral("Hello Qt!"));
+    QVERIFY(!sst.getSharedString(0).isRichString());
+    QCOMPARE(sst.getSharedString(1), rs2);
+}
+
 void SharedStringsTest::testRemoveSharedString()
 {
     QXlsx::SharedStrings sst(QXlsx::SharedStrings::F_NewFromScratch);
@@ -99,6 +127,62 @@ void SharedStringsTest::testRemoveSharedString()
     QCOMPARE(uniqueCount, 2);
 }
 
+void SharedStringsTest::testCompact()
+{
+    QXlsx::SharedStrings sst(QXlsx::SharedStrings::F_NewFromScratch);
+    sst.addSharedString("Hello Qt!");
+    sst.addSharedString("Xlsx Writer");
+    sst.addSharedString("Hello World");
+    sst.addSharedString("Hello Qt!");
+    QVERIFY(sst.compact().isEmpty());
+
+    //Cells which used the strings have been overwritten.
+    sst.decRefByStringIndex(1);
+    sst.decRefByStringIndex(0);
+    QCOMPARE(sst.uniqueCount(), 3);
+    QCOMPARE(sst.count(), 2);
+
+    QVector<int> indexMap = sst.compact();
+    QCOMPARE(indexMap, QVector<int>() << 0 << -1 << 1);
+    QCOMPARE(sst.uniqueCount(), 2);
+    QCOMPARE(sst.count(), 2);
+    QCOMPARE(sst.getSharedStringIndex("Hello World"), 1);
+    QCOMPARE(sst.getSharedStringIndex("Xlsx Writer"), -1);
+    QCOMPARE(sst.addSharedString("Xlsx Writer"), 2);
+}
+
+void SharedStringsTest::testInternString()
+{
+    QXlsx::SharedStrings sst(QXlsx::SharedStrings::F_NewFromScratch);
+    sst.addSharedString("Hello Qt!");
+    QXlsx::StringId world = sst.intern("Hello World");
+    QXlsx::StringId qt = sst.intern("Hello Qt!");
+    QVERIFY(world.isValid());
+    QVERIFY(world != qt);
+    QVERIFY(sst.intern("Hello World") == world);
+    QVERIFY(!QXlsx::StringId().isValid());
+    QCOMPARE(sst.addSharedString(QXlsx::StringId()), -1);
+
+    //Interning doesn't add a cell.
+    QCOMPARE(sst.count(), 1);
+    QCOMPARE(sst.uniqueCount(), 2);
+
+    QCOMPARE(sst.addSharedString(world), 1);
+    QCOMPARE(sst.addSharedString(qt), 0);
+    QCOMPARE(sst.count(), 3);
+
+    //Interned strings survive the compaction, with their new index.
+    sst.decRefByStringIndex(0);
+    sst.decRefByStringIndex(0);
+    sst.decRefByStringIndex(1);
+    sst.addSharedString("Xlsx Writer");
+    sst.decRefByStringIndex(2);
+    QCOMPARE(sst.compact(), QVector<int>() << 0 << 1 << -1);
+    QCOMPARE(sst.uniqueCount(), 2);
+    QCOMPARE(sst.count(), 0);
+    QCOMPARE(sst.addSharedString(world), 1);
+}
+
 void SharedStringsTest::testLoadXmlData()
 {
     QXlsx::SharedStrings sst(QXlsx::SharedStrings::F_NewFromScratch);
@@ -16,6 +16,8 @@ private Q_SLOTS:
     void testEmptyStyle();
     void testAddXfFormat();
     void testAddXfFormat2();
+    void testIntern();
+    void testAddRegisteredFormat();
     void testSolidFillBackgroundColor();
 
     void testWriteBorders();
@@ -70,6 +72,52 @@ void StylesTest::testAddXfFormat2()
     QCOMPARE(format2.numberFormatIndex(), 176);
 }
 
+void StylesTest::testIntern()
+{
+    QXlsx::Styles styles(QXlsx::Styles::F_NewFromScratch);
+
+    QVERIFY(!styles.intern(QXlsx::Format()).isValid());
+
+    QXlsx::Format format;
+    format.setFontBold(true);
+    QXlsx::StyleId id = styles.intern(format);
+    QVERIFY(id.isValid());
+    QCOMPARE(id.xfIndex(), 1);
+
+    QXlsx::Format format2;
+    format2.setFontBold(true);
+    QCOMPARE(styles.intern(format2), id);
+
+    QXlsx::Format format3;
+    format3.setFontItalic(true);
+    QVERIFY(styles.intern(format3) != id);
+    QCOMPARE(styles.xfFormat(id.xfIndex()), format);
+}
+
+void StylesTest::testAddRegisteredFormat()
+{
+    QXlsx::Styles styles(QXlsx::Styles::F_NewFromScratch);
+
+    QXlsx::Format format;
+    format.setFontBold(true);
+    styles.addXfFormat(format);
+    styles.addXfFormat(format);
+    QCOMPARE(format.xfIndex(), 1);
+    QCOMPARE(styles.m_xf_formatsList.size(), 2);
+
+    //Changing the format registers it again.
+    format.setFontItalic(true);
+    styles.addXfFormat(format);
+    QCOMPARE(format.xfIndex(), 2);
+    QCOMPARE(styles.m_xf_formatsList.size(), 3);
+    QCOMPARE(styles.m_fontsList.size(), 3);
+
+    //Another styles doesn't take it as registered.
+    QXlsx::Styles styles2(QXlsx::Styles::F_NewFromScratch);
+    styles2.addXfFormat(format);
+    QCOMPARE(styles2.m_xf_formatsList.size(), 2);
+}
+
 // For a solid fill, Excel reverses the role of foreground and background colours
 void StylesTest::testSolidFillBackgroundColor()
 {
@@ -44,6 +44,7 @@ private Q_SLOTS:
 
     void test_datetimeFromNumber_data();
     void test_datetimeFromNumber();
+    void test_datetimesToNumbers();
 
     void test_createSafeSheetName_data();
     void test_createSafeSheetName();
@@ -129,6 +130,52 @@ void UtilityTest::test_datetimeFromNumber()
     QCOMPARE(QXlsx::datetimeFromNumber(num, is1904), dt);
 }
 
+void UtilityTest::test_datetimesToNumbers()
+{
+    const QDateTime datetimes[] = {
+        QDateTime(QDate(1899, 12, 31), QTime(1, 30)),
+        QDateTime(QDate(1900, 2, 28), QTime(0, 0)),
+        QDateTime(QDate(1900, 3, 1), QTime(0, 0)),
+        QDateTime(QDate(2014, 7, 15), QTime(18, 45, 30, 250)),
+        QDateTime(QDate(2038, 1, 19), QTime(3, 14, 8))
+    };
+    const int count = 5;
+    //The numbers are the wall clock times, whatever the time zone is.
+    const double expected[2][count] = {
+        { 0.0625, 59, 61, 41835 + 67530.25 / 86400, 50424 + 11648 / 86400.0 },
+        { -1460.9375, -1402, -1401, 40373 + 67530.25 / 86400, 48962 + 11648 / 86400.0 }
+    };
+
+    for (int i=0; i<2; ++i) {
+        const bool is1904 = i == 1;
+        double numbers[count];
+        QXlsx::datetimesToNumbers(datetimes, numbers, count, is1904);
+        QDateTime results[count];
+        QXlsx::datetimesFromNumbers(numbers, results, count, is1904);
+        for (int j=0; j<count; ++j) {
+            QCOMPARE(numbers[j], expected[i][j]);
+            QCOMPARE(results[j], datetimes[j]);
+        }
+    }
+
+    //Epoch milliseconds are UTC.
+    const qint64 msecs[] = { 0, 86400000 + 21600000, -2208988800000LL, 1405449930250LL };
+    double numbers[4];
+    QXlsx::datetimesToNumbers(msecs, numbers, 4);
+    QCOMPARE(numbers[0], 25569.0);
+    QCOMPARE(numbers[1], 25570.25);
+    QCOMPARE(numbers[2], 1.0);
+    QCOMPARE(numbers[3], 41835 + 67530.25 / 86400);
+    QXlsx::datetimesToNumbers(msecs, numbers, 2, true);
+    QCOMPARE(numbers[0], 24107.0);
+
+    qint64 results[4];
+    QXlsx::datetimesToNumbers(msecs, numbers, 4);
+    QXlsx::datetimesFromNumbers(numbers, results, 4);
+    for (int i=0; i<4; ++i)
+        QCOMPARE(results[i], msecs[i]);
+}
+
 void UtilityTest::test_createSafeSheetName_data()
 {
     QTest::addColumn<QString>("original");
@@ -3,6 +3,7 @@
 #include <QXmlStreamReader>
 
 #include "xlsxworksheet.h"
+#include "xlsxworkbook.h"
 #include "xlsxcell.h"
 #include "xlsxcellrange.h"
 #include "xlsxdatavalidation.h"
@@ -25,12 +26,23 @@ private Q_SLOTS:
     void testSetColumn();
 
     void testWriteCells();
+    void testWriteCellText();
     void testWriteHyperlinks();
     void testWriteDataValidations();
     void testMerge();
     void testUnMerge();
+    void testStreamingWindow();
+    void testCellTable();
+    void testWriteStyleId();
+    void testCellObjectStringIndex();
+    void testStringStoragePolicy();
+    void testRowSpans();
+    void testWriteRow();
+    void testWriteNumericColumn();
+    void testWriteDateTimeColumn();
 
     void testReadSheetData();
+    void testReadSheetDataWithoutReference();
     void testReadColsInfo();
     void testReadRowsInfo();
     void testReadMergeCells();
@@ -121,6 +133,28 @@ void WorksheetTest::testWriteCells()
     QCOMPARE(sheet.d_func()->sharedStrings()->getSharedString(0).toPlainString(), QStringLiteral("Hello"));
 }
 
+void WorksheetTest::testWriteCellText()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.writeInlineString(1, 1, "a<b> & \"c\""); //A1
+    sheet.writeInlineString(2, 1, " padded "); //A2
+    sheet.writeInlineString(3, 1, QString::fromUtf8("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80")); //A3
+    sheet.write(4, 16384, 0.25); //XFD4
+    sheet.write(5, 27, -1234567); //AA5
+    sheet.write(6, 1, 1e20); //A6
+    sheet.writeFormula(7, 1, QXlsx::CellFormula("IF(A5<0,\"<0\",\"\")")); //A7
+
+    QByteArray xmldata = sheet.saveToXmlData();
+
+    QVERIFY2(xmldata.contains("<c r=\"A1\" t=\"inlineStr\"><is><t>a&lt;b&gt; &amp; &quot;c&quot;</t></is></c>"), "escaped");
+    QVERIFY2(xmldata.contains("<c r=\"A2\" t=\"inlineStr\"><is><t xml:space=\"preserve\"> padded </t></is></c>"), "space preserved");
+    QVERIFY2(xmldata.contains("<c r=\"A3\" t=\"inlineStr\"><is><t>\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80</t></is></c>"), "utf-8");
+    QVERIFY2(xmldata.contains("<c r=\"XFD4\"><v>0.25</v></c>"), "last column");
+    QVERIFY2(xmldata.contains("<c r=\"AA5\"><v>-1234567</v></c>"), "negative number");
+    QVERIFY2(xmldata.contains("<c r=\"A6\"><v>1e+20</v></c>"), "exponent");
+    QVERIFY2(xmldata.contains("<c r=\"A7\"><f ca=\"1\">IF(A5&lt;0,&quot;&lt;0&quot;,&quot;&quot;)</f><v>0</v></c>"), "formula");
+}
+
 void WorksheetTest::testWriteHyperlinks()
 {
     QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
@@ -181,6 +215,311 @@ void WorksheetTest::testUnMerge()
     QVERIFY2(!xmldata.contains("<mergeCell"), "");
 }
 
+void WorksheetTest::testStreamingWindow()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.setStreamingWindow(16);
+    QCOMPARE(sheet.streamingWindow(), 16);
+
+    for (int row=1; row<=100; ++row) {
+        QVERIFY(sheet.write(row, 1, row));
+        QVERIFY(sheet.write(row, 2, "Hello"));
+    }
+
+    //Rows 1 to 80 have been streamed out.
+    QCOMPARE(sheet.d_func()->cellTable.rowCount(), 20);
+    QVERIFY(!sheet.cellAt(1, 1));
+    QVERIFY(!sheet.write(1, 1, 1));
+    QCOMPARE(sheet.cellAt(81, 1)->value().toInt(), 81);
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange("A1:B100"));
+
+    QByteArray xmldata = sheet.saveToXmlData();
+
+    QVERIFY2(xmldata.contains("<sheetData><row r=\"1\" spans=\"1:2\"><c r=\"A1\"><v>1</v></c><c r=\"B1\" t=\"s\"><v>0</v></c></row>"), "streamed rows");
+    QVERIFY2(xmldata.contains("</row><row r=\"81\" spans=\"1:2\"><c r=\"A81\"><v>81</v></c>"), "rows in memory");
+    QVERIFY2(xmldata.contains("<c r=\"A100\"><v>100</v></c><c r=\"B100\" t=\"s\"><v>0</v></c></row></sheetData>"), "last row");
+    QCOMPARE(xmldata.count("<row "), 100);
+
+    //Saving twice gives the same result.
+    QCOMPARE(sheet.saveToXmlData(), xmldata);
+
+    //A copy keeps the rows streamed out already.
+    QScopedPointer<QXlsx::Worksheet> copy(sheet.copy("Copy", 2));
+    QVERIFY(!copy.isNull());
+    QCOMPARE(copy->dimension(), QXlsx::CellRange("A1:B100"));
+    QCOMPARE(copy->saveToXmlData(), xmldata);
+    QVERIFY(!copy->write(1, 1, 1));
+    QVERIFY(copy->write(101, 1, 101));
+    QCOMPARE(sheet.saveToXmlData(), xmldata);
+}
+
+void WorksheetTest::testCellTable()
+{
+    QCOMPARE(int(sizeof(QXlsx::CellTable::CellRecord)), 16);
+
+    QXlsx::CellTable table;
+    QVERIFY(table.isEmpty());
+
+    table.setNumber(3, 2, 1.5, -1);
+    table.setString(3, 1, 7, 2);
+    table.setBoolean(20, 5, true, -1);
+    table.setBlank(17, 4, 3);
+    QCOMPARE(table.rowCount(), 3);
+    QCOMPARE(table.blockCount(), 2);
+    QCOMPARE(table.boundingRange(), QXlsx::CellRange("A3:E20"));
+
+    QCOMPARE(table.kind(3, 2), QXlsx::CellTable::NumberCell);
+    QCOMPARE(table.number(3, 2), 1.5);
+    QCOMPARE(table.kind(3, 1), QXlsx::CellTable::StringCell);
+    QCOMPARE(table.stringIndex(3, 1), 7);
+    QCOMPARE(table.style(3, 1), 2);
+    QCOMPARE(table.kind(20, 5), QXlsx::CellTable::BooleanCell);
+    QCOMPARE(table.kind(17, 4), QXlsx::CellTable::BlankCell);
+    QCOMPARE(table.kind(3, 3), QXlsx::CellTable::NoCell);
+    QCOMPARE(table.kind(4, 2), QXlsx::CellTable::NoCell);
+
+    QCOMPARE(table.nextRow(0), 3);
+    QCOMPARE(table.nextRow(3), 17);
+    QCOMPARE(table.nextRow(16), 17);
+    QCOMPARE(table.nextRow(17), 20);
+    QCOMPARE(table.nextRow(20), -1);
+
+    //The columns of a block are kept sorted
+    const QXlsx::CellTable::Block *block = table.block(0);
+    QCOMPARE(block->columns.size(), 2);
+    QCOMPARE(block->columns[0].column, 1);
+    QCOMPARE(block->columns[1].column, 2);
+
+    //Only the rows which have a cell take a record
+    QCOMPARE(block->columns[0].cells.size(), 1);
+    table.setNumber(12, 1, 4.5, -1);
+    table.setNumber(5, 1, 3.5, -1);
+    QCOMPARE(block->columns[0].cells.size(), 3);
+    QCOMPARE(table.stringIndex(3, 1), 7);
+    QCOMPARE(table.number(5, 1), 3.5);
+    QCOMPARE(table.number(12, 1), 4.5);
+    table.remove(5, 1);
+    table.remove(12, 1);
+    QCOMPARE(block->columns[0].cells.size(), 1);
+    QCOMPARE(table.stringIndex(3, 1), 7);
+
+    table.remove(3, 1);
+    table.remove(3, 2);
+    QVERIFY(!table.containsRow(3));
+    QCOMPARE(table.boundingRange(), QXlsx::CellRange("D17:E20"));
+
+    table.removeRows(17);
+    QCOMPARE(table.rowCount(), 1);
+    QVERIFY(table.containsRow(20));
+
+    //Typed cells are turned into Cell objects on demand
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write(1, 1, 12.5);
+    sheet.write(1, 2, QStringLiteral("Hello"));
+    sheet.write(1, 3, true);
+    QCOMPARE(sheet.read(1, 2).toString(), QStringLiteral("Hello"));
+    QCOMPARE(sheet.d_func()->cellTable.kind(1, 1), QXlsx::CellTable::NumberCell);
+    QCOMPARE(sheet.cellAt(1, 1)->value().toDouble(), 12.5);
+    QCOMPARE(sheet.cellAt(1, 2)->cellType(), QXlsx::Cell::SharedStringType);
+    QCOMPARE(sheet.cellAt(1, 3)->value().toBool(), true);
+    QCOMPARE(sheet.d_func()->cellTable.kind(1, 1), QXlsx::CellTable::ObjectCell);
+
+    //Inline strings and formulas live in side tables, which are cleared when overwritten
+    sheet.writeInlineString(2, 1, QStringLiteral("Inline"));
+    sheet.writeFormula(2, 2, QXlsx::CellFormula("A1*2"), 25);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 1), QXlsx::CellTable::InlineStringCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 2), QXlsx::CellTable::FormulaCell);
+    QCOMPARE(sheet.read(2, 1).toString(), QStringLiteral("Inline"));
+    QCOMPARE(sheet.read(2, 2).toString(), QStringLiteral("=A1*2"));
+    QCOMPARE(sheet.cellAt(2, 2)->value().toDouble(), 25.0);
+    QCOMPARE(sheet.cellAt(2, 2)->formula().formulaText(), QStringLiteral("A1*2"));
+    sheet.write(2, 1, 2);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 1), QXlsx::CellTable::NumberCell);
+    QVERIFY(sheet.d_func()->cellTable.inlineString(2, 1).toPlainString().isEmpty());
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("<row r=\"1\" spans=\"1:3\"><c r=\"A1\"><v>12.5</v></c><c r=\"B1\" t=\"s\"><v>0</v></c><c r=\"C1\" t=\"b\"><v>1</v></c></row>"), "");
+}
+
+void WorksheetTest::testWriteStyleId()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QXlsx::Format format;
+    format.setFontBold(true);
+    QXlsx::StyleId bold = sheet.workbook()->internStyle(format);
+    QVERIFY(bold.isValid());
+
+    sheet.writeNumeric(1, 1, 10, bold);
+    sheet.writeString(1, 2, QStringLiteral("Hello"), bold);
+    sheet.writeBool(1, 3, true, bold);
+    sheet.writeBlank(1, 4, bold);
+    sheet.writeFormula(1, 5, QXlsx::CellFormula("A1*2"), bold, 20);
+    QCOMPARE(sheet.cellAt(1, 1)->format(), format);
+    QCOMPARE(sheet.d_func()->cellTable.style(1, 5), bold.xfIndex());
+
+    //An invalid handle keeps the style of the cell
+    sheet.writeNumeric(1, 1, 11, QXlsx::StyleId());
+    QCOMPARE(sheet.d_func()->cellTable.style(1, 1), bold.xfIndex());
+    sheet.writeNumeric(2, 1, 11, QXlsx::StyleId());
+    QCOMPARE(sheet.d_func()->cellTable.style(2, 1), -1);
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("<c r=\"A1\" s=\"1\"><v>11</v></c><c r=\"B1\" s=\"1\" t=\"s\"><v>0</v></c>"
+                              "<c r=\"C1\" s=\"1\" t=\"b\"><v>1</v></c><c r=\"D1\" s=\"1\"/>"
+                              "<c r=\"E1\" s=\"1\"><f ca=\"1\">A1*2</f><v>20</v></c>"), "");
+}
+
+void WorksheetTest::testCellObjectStringIndex()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("A1", "Hello");
+    sheet.write("A2", "World");
+
+    //The cell object keeps the index of its string.
+    QXlsx::Cell *cell = sheet.cellAt("A2");
+    QVERIFY(cell);
+    QCOMPARE(cell->value().toString(), QStringLiteral("World"));
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("<c r=\"A2\" t=\"s\"><v>1</v></c>"), "string");
+}
+
+void WorksheetTest::testStringStoragePolicy()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QXlsx::Workbook *workbook = sheet.workbook();
+    QCOMPARE(workbook->stringStoragePolicy(), QXlsx::Workbook::SharedStringStorage);
+
+    workbook->setStringStoragePolicy(QXlsx::Workbook::InlineStringStorage);
+    sheet.write("A1", "Inline");
+    QCOMPARE(sheet.d_func()->cellTable.kind(1, 1), QXlsx::CellTable::InlineStringCell);
+
+    //Unique values in column B, repeated ones in column C.
+    workbook->setStringStoragePolicy(QXlsx::Workbook::AdaptiveStringStorage);
+    for (int row=1; row<=1100; ++row) {
+        sheet.write(row, 2, QString("Id %1").arg(row));
+        sheet.write(row, 3, QString("Status %1").arg(row % 10));
+    }
+    QCOMPARE(sheet.d_func()->cellTable.kind(1024, 2), QXlsx::CellTable::StringCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(1025, 2), QXlsx::CellTable::InlineStringCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(1100, 3), QXlsx::CellTable::StringCell);
+    QCOMPARE(sheet.read(1100, 2).toString(), QString("Id 1100"));
+    QCOMPARE(sheet.d_func()->sharedStrings()->uniqueCount(), 1024 + 10);
+}
+
+void WorksheetTest::testRowSpans()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write(1, 3, 1);
+    sheet.write(2, 5, 2);
+    sheet.write(17, 16384, 3);
+    sheet.write(20, 2, 4);
+    sheet.write(100000, 7, 5);
+
+    //Removing the cell of the last column narrows the span of the block.
+    sheet.d_func()->cellTable.remove(2, 5);
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("<row r=\"1\" spans=\"3:3\">"), "first block");
+    QVERIFY2(!xmldata.contains("<row r=\"2\""), "removed cell");
+    QVERIFY2(xmldata.contains("<row r=\"17\" spans=\"2:16384\">"), "second block");
+    QVERIFY2(xmldata.contains("<row r=\"20\" spans=\"2:16384\">"), "second block");
+    QVERIFY2(xmldata.contains("<row r=\"100000\" spans=\"7:7\">"), "last block");
+
+    //Rows which only have row info come in order with the ones with cells.
+    sheet.setRowHidden(18, 18, true);
+    sheet.setRowHeight(50000, 50000, 30);
+    xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("</row><row r=\"18\" spans=\"2:16384\" customHeight=\"0\" hidden=\"1\"/><row r=\"20\""), "hidden row");
+    QVERIFY2(xmldata.contains("<row r=\"20\" spans=\"2:16384\"><c r=\"B20\"><v>4</v></c></row><row r=\"50000\" ht=\"30\" customHeight=\"1\"/><row r=\"100000\""), "row info");
+}
+
+void WorksheetTest::testWriteRow()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QXlsx::Format format;
+    format.setFontBold(true);
+
+    QVector<QVariant> values;
+    values << 1 << 2.5 << true << QString("Hello") << QVariant() << QString("=A1+B1") << QDate(2014, 1, 1);
+    QVERIFY(sheet.writeRow(2, 2, values, format));
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange("B2:H2"));
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 2), QXlsx::CellTable::NumberCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 4), QXlsx::CellTable::BooleanCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 5), QXlsx::CellTable::StringCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 6), QXlsx::CellTable::BlankCell);
+    QCOMPARE(sheet.d_func()->cellTable.kind(2, 7), QXlsx::CellTable::FormulaCell);
+    QCOMPARE(sheet.read(2, 3).toDouble(), 2.5);
+    QCOMPARE(sheet.read(2, 5).toString(), QString("Hello"));
+    QCOMPARE(sheet.cellAt(2, 2)->format(), format);
+    QVERIFY(sheet.cellAt(2, 8)->isDateTime());
+
+    //The cells keep their style if no format is given.
+    QVERIFY(sheet.writeRow(2, 2, QVector<QVariant>() << 3 << QString("World")));
+    QCOMPARE(sheet.read(2, 2).toInt(), 3);
+    QCOMPARE(sheet.cellAt(2, 3)->format(), format);
+    QCOMPARE(sheet.d_func()->sharedStrings()->count(), 2);
+
+    //Nothing is written if the row doesn't fit in the sheet.
+    QVERIFY(!sheet.writeRow(3, 16384, QVector<QVariant>() << 1 << 2));
+    QVERIFY(!sheet.cellAt(3, 16384));
+
+    QVERIFY(sheet.writeRow(4, 1, QVector<double>() << 1.5 << 2.5));
+    QVERIFY(sheet.writeRow(5, 1, QStringList() << "A" << "Hello"));
+    QCOMPARE(sheet.read(4, 2).toDouble(), 2.5);
+    QCOMPARE(sheet.read(5, 2).toString(), QString("Hello"));
+    QCOMPARE(sheet.d_func()->sharedStrings()->uniqueCount(), 3);
+
+    QVector<QVector<QVariant> > range;
+    range << (QVector<QVariant>() << 1 << 2) << QVector<QVariant>() << (QVector<QVariant>() << 3);
+    QVERIFY(sheet.writeRange(QXlsx::CellReference("J10"), range));
+    QCOMPARE(sheet.read(10, 11).toInt(), 2);
+    QVERIFY(!sheet.cellAt(11, 10));
+    QCOMPARE(sheet.read(12, 10).toInt(), 3);
+}
+
+void WorksheetTest::testWriteNumericColumn()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    const double values[] = { 0.1, 0.1 + 0.2, -2.25, 1.0 / 3, 0.00015, 1.5e-5, 123456789.125, 42 };
+    QVERIFY(sheet.writeNumericColumn(3, 2, values, 8));
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange("B3:B10"));
+    QCOMPARE(sheet.read(6, 2).toDouble(), 1.0 / 3);
+    QVERIFY(!sheet.writeNumericColumn(QXlsx::XLSX_ROW_MAX, 2, values, 2));
+
+    //Written the same way as QString::number(value, 'g', 15).
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("<c r=\"B3\"><v>0.1</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B4\"><v>0.3</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B5\"><v>-2.25</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B6\"><v>0.333333333333333</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B7\"><v>0.00015</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B8\"><v>1.5e-05</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B9\"><v>123456789.125</v></c>"), "");
+    QVERIFY2(xmldata.contains("<c r=\"B10\"><v>42</v></c>"), "");
+}
+
+void WorksheetTest::testWriteDateTimeColumn()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    const QDateTime values[] = {
+        QDateTime(QDate(2014, 1, 1), QTime(0, 0)),
+        QDateTime(QDate(2014, 7, 15), QTime(18, 45, 30))
+    };
+    QVERIFY(sheet.writeDateTimeColumn(1, 1, values, 2));
+    QCOMPARE(sheet.d_func()->cellTable.number(1, 1), 41640.0);
+    QCOMPARE(sheet.read(1, 1).toDateTime(), values[0]);
+    QVERIFY(sheet.cellAt(2, 1)->isDateTime());
+    QCOMPARE(sheet.cellAt(2, 1)->dateTime(), values[1]);
+    QCOMPARE(sheet.cellAt(2, 1)->format().numberFormat(), sheet.workbook()->defaultDateFormat());
+
+    //Nothing is written if any of the date times is invalid.
+    const QDateTime invalid[] = { QDateTime(QDate(2014, 1, 1), QTime(0, 0)), QDateTime() };
+    QVERIFY(!sheet.writeDateTimeColumn(3, 1, invalid, 2));
+    QVERIFY(!sheet.d_func()->cellTable.contains(3, 1));
+    QVERIFY(!sheet.d_func()->cellTable.contains(4, 1));
+}
+
 void WorksheetTest::testReadSheetData()
 {
     const QByteArray xmlData = "<sheetData>"
@@ -202,7 +541,7 @@ void WorksheetTest::testReadSheetData()
     sheet.d_func()->sharedStrings()->addSharedString("Hello");
     sheet.d_func()->loadXmlSheetData(reader);
 
-    QCOMPARE(sheet.d_func()->cellTable.size(), 2);
+    QCOMPARE(sheet.d_func()->cellTable.rowCount(), 2);
 
     //A1
     QCOMPARE(sheet.cellAt("A1")->cellType(), QXlsx::Cell::SharedStringType);
@@ -231,6 +570,36 @@ void WorksheetTest::testReadSheetData()
     QCOMPARE(sheet.cellAt("E3")->value().toString(), QStringLiteral("#DIV/0!"));
 }
 
+void WorksheetTest::testReadSheetDataWithoutReference()
+{
+    const QByteArray xmlData = "<sheetData>"
+            "<row r=\"2\">"
+            "<c><v>1</v></c>"
+            "<c r=\"C2\"><v>3</v></c>"
+            "<c><v>4</v></c>"
+            "</row>"
+            "<row>"
+            "<c><v>5</v></c>"
+            "<c r=\"a1\"><v>6</v></c>"
+            "<c r=\"XFE3\"><v>7</v></c>"
+            "</row>"
+            "<row r=\"0\"><c><v>8</v></c></row>"
+            "</sheetData>";
+    QXmlStreamReader reader(xmlData);
+    reader.readNextStartElement();//current node is sheetData
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    sheet.d_func()->loadXmlSheetData(reader);
+
+    //Cells follow the previous one, the ones out of the sheet are dropped.
+    QCOMPARE(sheet.read(2, 1).toInt(), 1);
+    QCOMPARE(sheet.read(2, 3).toInt(), 3);
+    QCOMPARE(sheet.read(2, 4).toInt(), 4);
+    QCOMPARE(sheet.read(3, 1).toInt(), 5);
+    QCOMPARE(sheet.d_func()->cellTable.rowCount(), 2);
+    QCOMPARE(sheet.d_func()->cellTable.boundingRange(), QXlsx::CellRange("A2:D3"));
+}
+
 void WorksheetTest::testReadColsInfo()
 {
     const QByteArray xmlData = "<cols>"
@@ -1,4 +1,6 @@
 #include "private/xlsxzipreader_p.h"
+#include "private/xlsxzipcodec_p.h"
+#include "private/xlsxzipwriter_p.h"
 #include <QString>
 #include <QtTest>
 #include <QBuffer>
@@ -14,6 +16,9 @@ public:
     
 private Q_SLOTS:
     void testFileList();
+    void testCodec();
+    void testCorruptSize_data();
+    void testCorruptSize();
 };
 
 ZipReaderTest::ZipReaderTest()
@@ -35,6 +40,53 @@ void ZipReaderTest::testFileList()
     QCOMPARE(reader.fileData("qt/xlsx.txt"), QByteArray("Xlsx"));
 }
 
+void ZipReaderTest::testCodec()
+{
+    QByteArray data(fileContent, sizeof(fileContent) - 1);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QXlsx::ZipReader reader(&buffer, QXlsx::ZipCodec::zlib());
+    QVERIFY(reader.exists());
+
+    QStringList files = reader.filePaths();
+    QCOMPARE(files, QStringList() << "hello.txt" << "qt/xlsx.txt");
+    QCOMPARE(reader.fileData("hello.txt"), QByteArray("Hello"));
+    QCOMPARE(reader.fileData("qt/xlsx.txt"), QByteArray("Xlsx"));
+}
+
+void ZipReaderTest::testCorruptSize_data()
+{
+    QTest::addColumn<quint32>("size");
+
+    QTest::newRow("negative as int") << quint32(0xf0000000);
+    QTest::newRow("above the deflate ratio") << quint32(3000000);
+}
+
+void ZipReaderTest::testCorruptSize()
+{
+    QFETCH(quint32, size);
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    QXlsx::ZipWriter writer(&buffer);
+    writer.addFile("big.xml", QByteArray(10000, 'x'));
+    writer.close();
+    buffer.close();
+
+    //Overwrite the uncompressed size of the central directory.
+    const int header = data.indexOf("PK\x01\x02");
+    QVERIFY(header > 0);
+    for (int i=0; i<4; ++i)
+        data[header + 24 + i] = char((size >> (i * 8)) & 0xff);
+
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer, QXlsx::ZipCodec::zlib());
+    QCOMPARE(reader.filePaths(), QStringList() << "big.xml");
+    QCOMPARE(reader.fileData("big.xml"), QByteArray());
+}
+
 QTEST_APPLESS_MAIN(ZipReaderTest)
 
 #include "tst_zipreadertest.moc"
@@ -0,0 +1,331 @@
+#include "private/xlsxzipwriter_p.h"
+#include "private/xlsxzipreader_p.h"
+#include "private/xlsxzipcodec_p.h"
+#include <QString>
+#include <QtTest>
+#include <QBuffer>
+
+//A write only device which can't seek, such as a socket or a pipe.
+class SequentialBuffer : public QIODevice
+{
+public:
+    SequentialBuffer() { open(QIODevice::WriteOnly); }
+    bool isSequential() const { return true; }
+    QByteArray data;
+
+protected:
+    qint64 readData(char *, qint64) { return -1; }
+    qint64 writeData(const char *d, qint64 size) { data.append(d, size); return size; }
+};
+
+class ZipWriterTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    ZipWriterTest();
+
+private Q_SLOTS:
+    void testAddFile();
+    void testBeginFile();
+    void testSequentialDevice();
+    void testParallelCompression_data();
+    void testParallelCompression();
+    void testParallelBeginFile();
+    void testDeflateBlocks_data();
+    void testDeflateBlocks();
+    void testCompressionLevel();
+    void testCodec_data();
+    void testCodec();
+
+private:
+    QByteArray largeData() const;
+    void writeEntries(QXlsx::ZipWriter &writer) const;
+};
+
+ZipWriterTest::ZipWriterTest()
+{
+}
+
+QByteArray ZipWriterTest::largeData() const
+{
+    QByteArray data;
+    for (int i=0; i<100000; ++i)
+        data.append(QByteArray("<row r=\"") + QByteArray::number(i+1) + "\"><c><v>" + QByteArray::number(i*7) + "</v></c></row>");
+    return data;
+}
+
+void ZipWriterTest::testAddFile()
+{
+    QByteArray zipData;
+    QBuffer buffer(&zipData);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXlsx::ZipWriter writer(&buffer);
+    writer.addFile("hello.txt", QByteArray("Hello"));
+    writer.addFile("qt/xlsx.txt", largeData());
+    writer.close();
+    QVERIFY(!writer.error());
+    buffer.close();
+
+    QVERIFY(zipData.size() < largeData().size() / 2);
+
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.filePaths(), QStringList() << "hello.txt" << "qt/xlsx.txt");
+    QCOMPARE(reader.fileData("hello.txt"), QByteArray("Hello"));
+    QCOMPARE(reader.fileData("qt/xlsx.txt"), largeData());
+}
+
+void ZipWriterTest::testBeginFile()
+{
+    QByteArray zipData;
+    QBuffer buffer(&zipData);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXlsx::ZipWriter writer(&buffer);
+    QIODevice *device = writer.beginFile("xl/worksheets/sheet1.xml");
+    const QByteArray data = largeData();
+    for (int i=0; i<data.size(); i+=1000)
+        device->write(data.mid(i, 1000));
+    writer.addFile("hello.txt", QByteArray("Hello"));
+    writer.beginFile("empty.xml");
+    writer.close();
+    QVERIFY(!writer.error());
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.filePaths().size(), 3);
+    QCOMPARE(reader.fileData("xl/worksheets/sheet1.xml"), data);
+    QCOMPARE(reader.fileData("hello.txt"), QByteArray("Hello"));
+    QCOMPARE(reader.fileData("empty.xml"), QByteArray());
+}
+
+void ZipWriterTest::testSequentialDevice()
+{
+    SequentialBuffer output;
+    QXlsx::ZipWriter writer(&output);
+    writer.beginFile("xl/worksheets/sheet1.xml")->write(largeData());
+    writer.addFile("hello.txt", QByteArray("Hello"));
+    writer.close();
+    QVERIFY(!writer.error());
+
+    QBuffer buffer(&output.data);
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.fileData("xl/worksheets/sheet1.xml"), largeData());
+    QCOMPARE(reader.fileData("hello.txt"), QByteArray("Hello"));
+}
+
+void ZipWriterTest::writeEntries(QXlsx::ZipWriter &writer) const
+{
+    const QByteArray data = largeData();
+    for (int i=0; i<8; ++i) {
+        writer.addFile(QString("file%1.txt").arg(i), data.mid(i * 1000));
+        QIODevice *device = writer.beginFile(QString("sheet%1.xml").arg(i));
+        for (int j=0; j<data.size(); j+=1000+i)
+            device->write(data.mid(j, 1000 + i));
+        writer.addFile(QString("tiny%1.txt").arg(i), QByteArray("x"));
+        writer.writeFile(QString("part%1.xml").arg(i), data.mid(i * 500));
+    }
+}
+
+void ZipWriterTest::testParallelCompression_data()
+{
+    QTest::addColumn<bool>("sequential");
+
+    QTest::newRow("seekable") << false;
+    QTest::newRow("sequential") << true;
+}
+
+void ZipWriterTest::testParallelCompression()
+{
+    QFETCH(bool, sequential);
+
+    QByteArray zipData[2];
+    for (int parallel=0; parallel<2; ++parallel) {
+        SequentialBuffer output;
+        QBuffer buffer(&zipData[parallel]);
+        buffer.open(QIODevice::WriteOnly);
+
+        QXlsx::ZipWriter writer(sequential ? static_cast<QIODevice *>(&output) : &buffer);
+        writer.setParallelCompressionEnabled(parallel);
+        QCOMPARE(writer.isParallelCompressionEnabled(), bool(parallel));
+        writeEntries(writer);
+        writer.close();
+        QVERIFY(!writer.error());
+        if (sequential)
+            zipData[parallel] = output.data;
+    }
+
+    //The layout of the archive doesn't depend on the entries being
+    //compressed concurrently, only the time stamps of the two may differ.
+    QCOMPARE(zipData[1].size(), zipData[0].size());
+
+    QBuffer buffer1(&zipData[0]);
+    buffer1.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader1(&buffer1);
+    QBuffer buffer2(&zipData[1]);
+    buffer2.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader2(&buffer2);
+    QCOMPARE(reader2.filePaths().size(), 32);
+    QCOMPARE(reader2.filePaths(), reader1.filePaths());
+    QCOMPARE(reader2.fileData("file7.txt"), largeData().mid(7000));
+    QCOMPARE(reader2.fileData("sheet7.xml"), largeData());
+    QCOMPARE(reader2.fileData("tiny7.txt"), QByteArray("x"));
+    QCOMPARE(reader2.fileData("part7.xml"), largeData().mid(3500));
+}
+
+void ZipWriterTest::testParallelBeginFile()
+{
+    QByteArray zipData;
+    QBuffer buffer(&zipData);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXlsx::ZipWriter writer(&buffer);
+    writer.setParallelCompressionEnabled(true);
+    writer.addFile("hello.txt", QByteArray("Hello"));
+    QIODevice *device = writer.beginFile("xl/worksheets/sheet1.xml");
+    QVERIFY(!qobject_cast<QBuffer *>(device));
+
+    //The entry goes to the zip while it is written, it isn't collected first.
+    const qint64 headerEnd = zipData.size();
+    const QByteArray data = largeData();
+    for (int i=0; i<data.size(); i+=1000)
+        device->write(data.mid(i, 1000));
+    QVERIFY(zipData.size() > headerEnd);
+
+    writer.writeFile("xl/sharedStrings.xml", data);
+    writer.close();
+    QVERIFY(!writer.error());
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.filePaths(), QStringList() << "hello.txt" << "xl/worksheets/sheet1.xml" << "xl/sharedStrings.xml");
+    QCOMPARE(reader.fileData("hello.txt"), QByteArray("Hello"));
+    QCOMPARE(reader.fileData("xl/worksheets/sheet1.xml"), data);
+    QCOMPARE(reader.fileData("xl/sharedStrings.xml"), data);
+}
+
+void ZipWriterTest::testDeflateBlocks_data()
+{
+    QTest::addColumn<int>("size");
+
+    //Large entries are deflated in blocks of 128K.
+    QTest::newRow("one block") << 128 * 1024;
+    QTest::newRow("two blocks") << 256 * 1024;
+    QTest::newRow("two blocks and one byte") << 256 * 1024 + 1;
+    QTest::newRow("many blocks") << 3000 * 1024 + 17;
+}
+
+void ZipWriterTest::testDeflateBlocks()
+{
+    QFETCH(int, size);
+
+    const QByteArray data = largeData().left(size);
+    QCOMPARE(data.size(), size);
+
+    QByteArray zipData;
+    QBuffer buffer(&zipData);
+    buffer.open(QIODevice::WriteOnly);
+    QXlsx::ZipWriter writer(&buffer);
+    writer.addFile("sequential.xml", data);
+    writer.setParallelCompressionEnabled(true);
+    writer.addFile("parallel.xml", data);
+    writer.beginFile("streamed.xml")->write(data);
+    writer.close();
+    QVERIFY(!writer.error());
+    buffer.close();
+    QVERIFY(zipData.size() < data.size());
+
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.fileData("sequential.xml"), data);
+    QCOMPARE(reader.fileData("parallel.xml"), data);
+    QCOMPARE(reader.fileData("streamed.xml"), data);
+}
+
+void ZipWriterTest::testCompressionLevel()
+{
+    QByteArray zipData;
+    QBuffer buffer(&zipData);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXlsx::ZipWriter writer(&buffer);
+    QCOMPARE(writer.compressionLevel(), -1);
+    writer.setCompressionLevel(9);
+    writer.setCompressionLevel("xl/media/*", 0);
+    writer.setCompressionLevel("xl/fast*", 1);
+    QCOMPARE(writer.compressionLevel(), 9);
+    QCOMPARE(writer.compressionLevel("xl/media/image1.png"), 0);
+    QCOMPARE(writer.compressionLevel("xl/fast.xml"), 1);
+    QCOMPARE(writer.compressionLevel("xl/workbook.xml"), 9);
+
+    const QByteArray data = largeData();
+    writer.addFile("xl/media/image1.png", data);
+    writer.beginFile("xl/media/image2.png")->write(data);
+    writer.addFile("xl/fast.xml", data);
+    writer.addFile("xl/best.xml", data);
+    writer.close();
+    QVERIFY(!writer.error());
+    buffer.close();
+
+    //Both stored entries and their local headers.
+    QVERIFY(zipData.size() > 2 * data.size());
+
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.fileData("xl/media/image1.png"), data);
+    QCOMPARE(reader.fileData("xl/media/image2.png"), data);
+    QCOMPARE(reader.fileData("xl/fast.xml"), data);
+    QCOMPARE(reader.fileData("xl/best.xml"), data);
+}
+
+void ZipWriterTest::testCodec_data()
+{
+    QTest::addColumn<bool>("zlibNg");
+
+    QTest::newRow("zlib") << false;
+    if (QXlsx::ZipCodec::zlibNg())
+        QTest::newRow("zlib-ng") << true;
+}
+
+void ZipWriterTest::testCodec()
+{
+    QFETCH(bool, zlibNg);
+    const QXlsx::ZipCodec *codec = zlibNg ? QXlsx::ZipCodec::zlibNg() : QXlsx::ZipCodec::zlib();
+
+    QByteArray zipData;
+    QBuffer buffer(&zipData);
+    buffer.open(QIODevice::WriteOnly);
+
+    QXlsx::ZipWriter writer(&buffer);
+    QCOMPARE(writer.codec(), QXlsx::ZipCodec::defaultCodec());
+    writer.setCodec(codec);
+    QCOMPARE(writer.codec(), codec);
+    writer.setCompressionLevel("xl/media/*", 0);
+    writeEntries(writer);
+    writer.addFile("xl/media/image1.png", largeData());
+    writer.close();
+    QVERIFY(!writer.error());
+    buffer.close();
+
+    //Whatever the codec, the archive is a plain deflated zip file.
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QXlsx::ZipReader codecReader(&buffer, codec);
+    QCOMPARE(codecReader.codec(), codec);
+    QVERIFY(codecReader.exists());
+    QCOMPARE(codecReader.filePaths(), reader.filePaths());
+    foreach (const QString &filePath, reader.filePaths())
+        QCOMPARE(codecReader.fileData(filePath), reader.fileData(filePath));
+    QCOMPARE(codecReader.fileData("sheet7.xml"), largeData());
+    QCOMPARE(codecReader.fileData("xl/media/image1.png"), largeData());
+    QCOMPARE(codecReader.fileData("missing.xml"), QByteArray());
+}
+
+QTEST_APPLESS_MAIN(ZipWriterTest)
+
+#include "tst_zipwritertest.moc"
@@ -0,0 +1,12 @@
+QT       += testlib xlsx xlsx-private
+CONFIG += testcase
+DEFINES += XLSX_TEST
+
+TARGET = tst_zipwritertest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += tst_zipwritertest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
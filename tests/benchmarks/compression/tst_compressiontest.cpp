@@ -0,0 +1,75 @@
+#include "xlsxdocument.h"
+#include <QString>
+#include <QBuffer>
+#include <QtTest>
+
+QTXLSX_USE_NAMESPACE
+
+class CompressionTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    CompressionTest();
+
+private Q_SLOTS:
+    void initTestCase();
+    void testSave();
+    void testSave_data();
+
+private:
+    Document m_xlsx;
+};
+
+CompressionTest::CompressionTest()
+{
+}
+
+void CompressionTest::initTestCase()
+{
+    for (int row=1; row<=20000; ++row) {
+        m_xlsx.write(row, 1, row);
+        m_xlsx.write(row, 2, QString("Item %1").arg(row % 500));
+        m_xlsx.write(row, 3, row * 0.25);
+        m_xlsx.write(row, 4, QDate(2014, 1, 1).addDays(row % 365));
+        m_xlsx.write(row, 5, QString("=A%1*C%1").arg(row));
+    }
+}
+
+void CompressionTest::testSave()
+{
+    QFETCH(int, level);
+    QFETCH(bool, parallel);
+
+    m_xlsx.setCompressionLevel(level);
+    m_xlsx.setParallelSaveEnabled(parallel);
+
+    qint64 size = 0;
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        m_xlsx.saveAs(&buffer);
+        size = buffer.size();
+    }
+    qDebug() << "level" << level << (parallel ? "parallel" : "sequential") << "size" << size;
+}
+
+void CompressionTest::testSave_data()
+{
+    QTest::addColumn<int>("level");
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("store") << 0 << false;
+    QTest::newRow("level 1") << 1 << false;
+    QTest::newRow("level 3") << 3 << false;
+    QTest::newRow("default") << -1 << false;
+    QTest::newRow("level 9") << 9 << false;
+    QTest::newRow("store, parallel") << 0 << true;
+    QTest::newRow("level 1, parallel") << 1 << true;
+    QTest::newRow("default, parallel") << -1 << true;
+    QTest::newRow("level 9, parallel") << 9 << true;
+}
+
+QTEST_APPLESS_MAIN(CompressionTest)
+
+#include "tst_compressiontest.moc"
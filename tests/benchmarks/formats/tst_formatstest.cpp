@@ -0,0 +1,65 @@
+#include "xlsxdocument.h"
+#include "xlsxformat.h"
+#include <QString>
+#include <QtTest>
+
+QTXLSX_USE_NAMESPACE
+
+class FormatsTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    FormatsTest();
+
+private Q_SLOTS:
+    void initTestCase();
+    void testWriteSharedFormats();
+
+private:
+    QList<Format> m_formats;
+};
+
+FormatsTest::FormatsTest()
+{
+}
+
+void FormatsTest::initTestCase()
+{
+    Format bold;
+    bold.setFontBold(true);
+    m_formats << bold;
+
+    Format money;
+    money.setNumberFormat(QStringLiteral("#,##0.00"));
+    m_formats << money;
+
+    Format filled;
+    filled.setPatternBackgroundColor(Qt::yellow);
+    m_formats << filled;
+
+    Format bordered;
+    bordered.setBorderStyle(Format::BorderThin);
+    m_formats << bordered;
+
+    Format centered;
+    centered.setHorizontalAlignment(Format::AlignHCenter);
+    centered.setFontColor(Qt::blue);
+    m_formats << centered;
+}
+
+void FormatsTest::testWriteSharedFormats()
+{
+    //1M cells, each column shares one of the five formats.
+    QBENCHMARK {
+        Document xlsx;
+        for (int row=1; row<=200000; ++row) {
+            for (int col=1; col<=5; ++col)
+                xlsx.write(row, col, row * col, m_formats[col-1]);
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(FormatsTest)
+
+#include "tst_formatstest.moc"
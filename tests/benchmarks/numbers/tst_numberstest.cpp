@@ -0,0 +1,83 @@
+#include "xlsxdocument.h"
+#include "private/xlsxsheetdatawriter_p.h"
+#include <QString>
+#include <QBuffer>
+#include <QVector>
+#include <QtTest>
+
+QTXLSX_USE_NAMESPACE
+
+class NumbersTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    NumbersTest();
+
+private Q_SLOTS:
+    void initTestCase();
+    void testQStringNumber();
+    void testWriteDouble();
+    void testSaveNumericColumns();
+
+private:
+    QVector<double> m_values;
+};
+
+NumbersTest::NumbersTest()
+{
+}
+
+void NumbersTest::initTestCase()
+{
+    //Prices, rates and amounts, as a financial export has them.
+    for (int i=0; i<200000; ++i) {
+        switch (i % 4) {
+        case 0: m_values << (i * 37 % 1000000) / 100.0; break;
+        case 1: m_values << 1.0 / (i + 3); break;
+        case 2: m_values << (i % 997) * 0.1 + 0.2; break;
+        default: m_values << -(i % 5000) * 1.25e-5; break;
+        }
+    }
+}
+
+void NumbersTest::testQStringNumber()
+{
+    //What the sheet data used to be written with.
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        SheetDataWriter writer(&buffer);
+        for (int i=0; i<m_values.size(); ++i) {
+            const QByteArray number = QString::number(m_values[i], 'g', 15).toUtf8();
+            writer.writeRaw(number.constData(), number.size());
+        }
+    }
+}
+
+void NumbersTest::testWriteDouble()
+{
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        SheetDataWriter writer(&buffer);
+        for (int i=0; i<m_values.size(); ++i)
+            writer.writeDouble(m_values[i]);
+    }
+}
+
+void NumbersTest::testSaveNumericColumns()
+{
+    QBENCHMARK {
+        Document xlsx;
+        for (int col=1; col<=5; ++col)
+            xlsx.currentWorksheet()->writeNumericColumn(1, col, m_values.constData(), m_values.size());
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        xlsx.saveAs(&buffer);
+    }
+}
+
+QTEST_APPLESS_MAIN(NumbersTest)
+
+#include "tst_numberstest.moc"